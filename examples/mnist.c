@@ -25,7 +25,7 @@ scyte_network* make_model_mnist()
 int run_model_mnist(int argc, char** argv)
 {
     srand(1337);
-    int epochs=1000, batch_size=256, predict=0, help=0;
+    int epochs=1000, batch_size=256, threads=1, predict=0, help=0;
     float lr=0.01f, momentum=0.9f, decay=0.0005f;
 
     const char* input_image_path = 0;
@@ -41,6 +41,7 @@ int run_model_mnist(int argc, char** argv)
     arg_option_float(&lr, 'r', "lr", "learning rate for model", ARG_REQUIRED);
     arg_option_float(&momentum, 'm', "momentum", "momentum", ARG_REQUIRED);
     arg_option_float(&decay, 'd', "decay", "l2 decay", ARG_REQUIRED);
+    arg_option_int(&threads, 't', "threads", "number of threads to split each minibatch across", ARG_REQUIRED);
     argc = arg_parse(argv);
 
     if(help) {
@@ -66,6 +67,7 @@ int run_model_mnist(int argc, char** argv)
         scyte_print_graph(model->n, model->nodes);
 
         scyte_optimizer_params params = scyte_sgd_params(lr, decay, momentum);
+        scyte_set_network_threads(model, threads);
         scyte_train_network(model, params, batch_size, epochs, 0.2, 10, d);
         double t2 = time_now();
         LOG_INFOF("training took %.3lf seconds, saving model..", t2-t1);
@@ -18,7 +18,7 @@ scyte_network* make_model_xor()
 
 static inline void train_xor(scyte_network* net, int epochs, float lr, float decay, float momentum)
 {
-    scyte_data d;
+    scyte_data d = { 0 };
     float* x[4] = { (float[]){ 0, 0 }, (float[]){ 0, 1, }, (float[]){ 1, 0 }, (float[]){ 1, 1 } };
     d.X.data = x; d.X.rows = 4, d.X.cols = 2;
     float* y[4] = { (float[]){ 0 }, (float[]){ 1 }, (float[]){ 1 }, (float[]){ 0 }, };
@@ -1,8 +1,34 @@
 #ifndef BLAS_H
 #define BLAS_H
 
+// name of the instruction set the kernels were selected for at startup, e.g. "avx2"
+const char* blas_get_isa();
+
 void gemm_cpu(int trans_a, int trans_b, int M, int N, int K,
         float alpha, const float* A, const float* B, float beta, float* C);
+// C += alpha*op(A)*op(B), with C stored transposed, as the N x M matrix C^T, if trans_c
+void gemm_acc_cpu(int trans_a, int trans_b, int trans_c, int M, int N, int K,
+        float alpha, const float* A, const float* B, float* C);
+
+// Packs the panel of n <= width rows of A, or columns of B, starting at first, over the depth k0
+// to k0+kc, as packed[k*width + r], zero-padded to width. Lets gemm_panels_cpu multiply matrices
+// that are never stored, like the columns of an implicit im2col
+typedef void (*gemm_panel_fn)(const void* ctx, int first, int k0, int n, int kc, int width, float* packed);
+
+// a row-major matrix op(X) with leading dimension ld, the ctx of gemm_pack_rows and gemm_pack_cols
+typedef struct {
+    const float* X;
+    int trans, ld;
+} gemm_matrix;
+
+void gemm_pack_rows(const void* ctx, int first, int k0, int n, int kc, int width, float* packed);
+void gemm_pack_cols(const void* ctx, int first, int k0, int n, int kc, int width, float* packed);
+
+// C += alpha*A*B, with the M x K matrix A and the K x N matrix B packed panel by panel
+void gemm_panels_cpu(int M, int N, int K, float alpha,
+        gemm_panel_fn pack_a, const void* ctx_a,
+        gemm_panel_fn pack_b, const void* ctx_b,
+        float* C, int ldc);
 
 void gemv_cpu(int trans_a, int M, int N, float alpha, 
         const float* A, const float* x, float beta, float* y);
@@ -23,7 +49,14 @@ void mul_sum_cpu(int n, const float* x, const float* y, float* z);
 void pow_cpu(int n, float alpha, const float* x, float* y);
 void scale_cpu(int n, float alpha, const float* x, float* y);
 void bias_cpu(int n, float alpha, const float* x, float* y);
-void exp_cpu(int n, const float* x, float* y);
 void abs_cpu(int n, const float* x, float* y);
 
+// vectorized polynomial approximations, within a few ulp, see src/blas_kernels.c
+void exp_cpu(int n, const float* x, float* y);
+void log_cpu(int n, const float* x, float* y);
+void tanh_cpu(int n, const float* x, float* y);
+void sigmoid_cpu(int n, const float* x, float* y);
+void sin_cpu(int n, const float* x, float* y);
+void cos_cpu(int n, const float* x, float* y);
+
 #endif
@@ -0,0 +1,42 @@
+#ifndef BLAS_KERNELS_H
+#define BLAS_KERNELS_H
+
+// largest register tile of any gemm micro-kernel, used to size scratch tiles
+#define GEMM_MAX_MR 12
+#define GEMM_MAX_NR 32
+
+// table of the instruction-set specific kernels behind the blas routines.
+// src/blas_kernels.c is compiled once per instruction set, each build exporting its own table
+typedef struct {
+    const char* name;
+    int mr, nr; // register tile of the gemm micro-kernel
+
+    // C[mr x nr] += alpha * a * b, where a and b are packed panels of length kc
+    void (*gemm_micro_kernel)(int kc, float alpha, const float* a, const float* b, float* C, int ldc);
+
+    void (*axpy)(int n, float alpha, const float* x, float* y);
+    void (*axpby)(int n, float alpha, const float* x, float beta, float* y);
+    void (*scale)(int n, float alpha, const float* x, float* y);
+    void (*add)(int n, const float* x, const float* y, float* z);
+    void (*sub)(int n, const float* x, const float* y, float* z);
+    void (*mul)(int n, const float* x, const float* y, float* z);
+    void (*div)(int n, const float* x, const float* y, float* z);
+    void (*mul_sum)(int n, const float* x, const float* y, float* z);
+    void (*bias)(int n, float alpha, const float* x, float* y);
+    void (*exp)(int n, const float* x, float* y);
+    void (*abs)(int n, const float* x, float* y);
+    void (*log)(int n, const float* x, float* y);
+    void (*tanh)(int n, const float* x, float* y);
+    void (*sigmoid)(int n, const float* x, float* y);
+    void (*sin)(int n, const float* x, float* y);
+    void (*cos)(int n, const float* x, float* y);
+} blas_kernels;
+
+extern const blas_kernels blas_kernels_generic;
+#if defined(__x86_64__) || defined(__i386__)
+extern const blas_kernels blas_kernels_sse42;
+extern const blas_kernels blas_kernels_avx2;
+extern const blas_kernels blas_kernels_avx512;
+#endif
+
+#endif
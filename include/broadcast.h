@@ -0,0 +1,29 @@
+#ifndef BROADCAST_H
+#define BROADCAST_H
+
+#include "scyte.h"
+
+// Elementwise binary ops (ADD, SUB, MULTIPLY) over operands of different shapes, by numpy rules:
+// the shapes are aligned at their last axes, missing leading axes have size 1, and an operand of
+// size 1 along an axis is repeated along it. Shapes numpy can't broadcast are still accepted when
+// the second operand's size divides the first's, the second is then repeated over the first as a
+// flat array, as scyte has always done.
+// The axes that all operands step over alike are collapsed, so the inner loops run over rows as
+// long as possible, with the vectorized kernels of blas.h whenever the operands are contiguous
+// or repeated along a row. Strided operands (see ops/transpose.h) are read in place.
+
+// the shape of the broadcast of a and b, 0 if numpy can't broadcast them
+int scyte_broadcast_shape(const scyte_node* a, const scyte_node* b, unsigned* num_dims, int* shape);
+// sets the shape of an ADD, SUB or MULTIPLY node to the broadcast of its children's
+int scyte_broadcast_sync_dims(scyte_node* node);
+// whether every child smaller than the node is repeated over it as a flat array, which is how
+// fused elementwise ops and epilogues broadcast
+int scyte_broadcast_repeats(const scyte_node* node);
+// whether the node reads strided children in place, the flat repeat needs them contiguous
+int scyte_broadcast_reads_strided(const scyte_node* node);
+
+void scyte_broadcast_forward(scyte_node* node);
+// accumulates the gradient of child i, summed over the axes it was broadcast along
+void scyte_broadcast_backward(scyte_node* node, int i);
+
+#endif
@@ -1,9 +1,15 @@
 #ifndef DATA_H
 #define DATA_H
 
+#include "sampler.h"
+
+#include <pthread.h>
+
 typedef struct {
     int rows, cols;
-    float** data;
+    float** data;   // row pointers, into slab if the matrix was made with scyte_make_matrix
+    float* slab;    // 64-byte aligned storage of all rows, NULL if the rows are allocated separately
+    int stride;     // distance between the rows in slab, padded to a multiple of 16 floats
 } matrix;
 
 typedef struct {
@@ -20,7 +26,43 @@ typedef struct {
     int end_idx; // what idx to stop loading the data at
 } load_args;
 
+// applied by the batch loader to every batch it assembles, e.g. to randomly flip or crop images
+typedef void (*scyte_augment_fn)(int batch_size, float* X, float* y, int x_cols, int y_cols);
+
+// Assembles batches on a producer thread ahead of training, into a ring of `depth` buffers.
+// Consuming a batch is thereby a pointer swap, while the next batches are copied meanwhile.
+// Batches are drawn from a sampler and never straddle its epochs, so the last batch of an
+// epoch can be smaller than batch_size.
+typedef struct {
+    scyte_data d;
+    scyte_sampler* sampler; // only used by the producer thread while the loader exists
+    int batch_size, depth;
+    scyte_augment_fn augment;
+    float** X, **y;         // the ring of batch buffers
+    int* sizes;             // number of samples in each batch buffer
+    int* indices;           // indices of the samples in the batch being assembled
+    int head, count;        // next batch to hand out, and number of batches ready
+    int in_use;             // the batch handed out last, which can't be refilled yet. -1 if none
+    int stop;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t ready, freed;
+} scyte_batch_loader;
+
+// makes a zeroed matrix whose rows are stored contiguously in one aligned slab
+matrix scyte_make_matrix(int rows, int cols);
+void scyte_free_matrix(matrix* m);
+// copies the rows with the given indices of m into out, one after another
+void scyte_gather_rows(const matrix* m, int n, const int* indices, float* out);
+
+// a batch of rows drawn with replacement from the calling thread's generator, see scyte_thread_rng.
+// scyte_batch_loader draws every row once per epoch
 void scyte_random_batch(scyte_data d, int batch_size, float* X, float* y);
+// starts the producer thread, depth is at least 2: one batch in use and one being prefetched
+scyte_batch_loader* scyte_make_batch_loader(scyte_data d, scyte_sampler* sampler, int batch_size, int depth, scyte_augment_fn augment);
+void scyte_free_batch_loader(scyte_batch_loader* loader);
+// hands out the next batch, which stays valid until the next call. returns its number of samples
+int scyte_next_batch(scyte_batch_loader* loader, float** X, float** y);
 scyte_data load_image_classification_data(const char* images, const char* label_file, int colored);
 
 void scyte_free_data(scyte_data* d);
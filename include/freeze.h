@@ -0,0 +1,18 @@
+#ifndef FREEZE_H
+#define FREEZE_H
+
+#include "scyte.h"
+
+// Graph pass that compiles a copy of a trained graph for inference only, see scyte_freeze_network:
+// - the variables become constants, so no node has a gradient or a delta anymore
+// - the dynamic selects (see scyte_layer_dropout) are replaced by their inference branch, and
+//   every node the output doesn't depend on, like the cost and the ground truth, is removed
+// - op-nodes of constants only are evaluated once and become constants themselves
+// - the affine transform of a layer norm is folded into the weights and the bias of the cmatmul
+//   that consumes it
+// - the graph is then fused again, see fusion.h
+// The graph must have a single output. The copy owns all of its values, the original is left
+// untouched. Returns the sorted nodes of the copy at batch size 1, NULL on failure
+scyte_node** scyte_freeze_graph(int* n, int num_nodes, scyte_node** nodes);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef FUSION_H
+#define FUSION_H
+
+#include "scyte.h"
+
+// y = act(y)
+void scyte_activate(int n, scyte_activation act, float* y);
+// delta *= act'(x), with the derivative expressed through the activated output y = act(x)
+void scyte_activation_gradient(int n, scyte_activation act, const float* y, float* delta);
+
+// Enables or disables scyte_fuse_graph, enabled by default
+void scyte_set_graph_fusion(int enabled);
+
+// Graph pass, run by scyte_make_network on the sorted graph, that saves memory passes and buffers:
+// - a bias added to a cmatmul, and a relu, sigmoid or tanh of it, are fused into the gemm, which
+//   starts from the bias and activates its output in place. Convolutions fuse the activation only.
+// - chains of add, sub, multiply, square, exp, sigmoid, tanh and relu become a single
+//   FUSED_ELEMENTWISE op, see ops/fused_elementwise.h.
+// Only op-nodes with a single consumer, and neither outputs nor costs, are fused into their consumer,
+// which keeps its place in the graph and its pointer. The fused nodes are freed and the array is
+// compacted in place, the operands keep their order. Returns the new number of nodes
+int scyte_fuse_graph(int n, scyte_node** nodes);
+
+#endif
@@ -19,6 +19,8 @@ scyte_node* scyte_layer_dropout(scyte_node* in, float dropout_rate);
 scyte_node* scyte_layer_layernorm(scyte_node* in);
 scyte_node* scyte_layer_cost(scyte_node* in, int num_out, cost_type type);
 scyte_node* scyte_layer_maxpool2d(scyte_node* in, int size, int stride, int padding);
+scyte_node* scyte_layer_avgpool2d(scyte_node* in, int size, int stride, int padding);
+scyte_node* scyte_layer_global_avgpool2d(scyte_node* in);
 scyte_node* scyte_layer_conv2d(scyte_node* in, int num_filters, int size, int stride, int padding);
 
 #endif
@@ -0,0 +1,40 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include "scyte.h"
+
+#include <stddef.h>
+
+// The element (n, c, h, w) of a tensor is stored at
+// n*batch + (c / block)*channel_block + h*row + w*col + (c % block)*channel,
+// which covers NCHW (block 1), NHWC (a single block of all channels) and the blocked layouts
+typedef struct {
+    int block;
+    size_t batch, channel_block, row, col, channel;
+} scyte_layout_strides;
+
+const char* scyte_layout_string(scyte_layout layout);
+// number of channels per block, 1 for NCHW and 0 for NHWC, whose block is all channels
+int scyte_layout_block(scyte_layout layout);
+// whether a tensor with the given number of channels can be stored in the layout
+int scyte_layout_supported(scyte_layout layout, int channels);
+scyte_layout_strides scyte_layout_get_strides(scyte_layout layout, const int shape[4]);
+
+static inline size_t scyte_layout_offset(const scyte_layout_strides* s, int n, int c, int h, int w)
+{
+    return n*s->batch + (c / s->block)*s->channel_block + h*s->row + w*s->col + (c % s->block)*s->channel;
+}
+
+// Reorders the NCHW shaped tensor src from one layout to another, dst = src or dst += src
+void scyte_layout_copy(const int shape[4], const float* src, scyte_layout src_layout,
+        float* dst, scyte_layout dst_layout, int accumulate);
+
+// Graph pass that runs the convolutions, and the pooling and elementwise ops between them, in the
+// given layout. Layout transforms are only inserted at the boundaries: before the convolutions that
+// take another layout, and before the ops that only support NCHW. Outputs, costs and the roots of the
+// graph stay in NCHW. The transforms are sorted right after the nodes they transform, so the order of
+// the other nodes, and thereby of the weights, doesn't change. Returns the new array of nodes, the
+// transforms have no values until the graph is resized or planned, see scyte_set_network_layout
+scyte_node** scyte_convert_layout(int* n, scyte_node** nodes, scyte_layout layout);
+
+#endif
@@ -6,6 +6,9 @@
 #include "layers.h"
 #include "optimizer.h"
 #include "data.h"
+#include "planner.h"
+#include "replica.h"
+#include "scheduler.h"
 
 // Generates a network from a computational graph.
 // A network must have at least one scalar cost node (i.e. whose num_dims==0).
@@ -13,11 +16,66 @@ scyte_network* scyte_make_network(scyte_node* cost_node);
 // create a network from multiple root nodes.
 scyte_network* scyte_make_network2(scyte_node* cost_node, int n_roots, scyte_node** roots);
 void scyte_free_network(scyte_network* net);
+// resizes a network for a new batch size. use this instead of scyte_set_batch_size, since the
+// op-nodes of a network live in its memory planned arena (mode is SCYTE_PLAN_PREDICT or SCYTE_PLAN_TRAIN)
+void scyte_set_network_batch_size(scyte_network* net, int batch_size, int mode);
 
+// Runs the convolutions of a network, and the pooling and elementwise ops between them, in another
+// layout, see scyte_convert_layout. The weights and the inputs and outputs stay in NCHW
+int scyte_set_network_layout(scyte_network* net, scyte_layout layout);
+
+// sets the number of threads scyte_train_network splits each minibatch across, each running its
+// own replica of the graph (see replica.h). 1 trains on the network's own graph, the default
+void scyte_set_network_threads(scyte_network* net, int num_threads);
+// sets the number of threads the independent branches of the network's graph run on, see
+// scheduler.h, when predicting and training on the network's own graph. 1 runs the ops in order
+void scyte_set_network_inter_op_threads(scyte_network* net, int num_threads);
+// sets the augmentation the batch loader of scyte_train_network applies to every training batch,
+// the validation batches are left as they are. NULL, the default, trains on the data as is
+void scyte_set_network_augment(scyte_network* net, scyte_augment_fn augment);
+// sets the seed scyte_train_network splits and samples the data with and seeds the generators of
+// all threads with (see random.h), so a training run is reproduced by the same seed. 0 by default
+void scyte_set_network_seed(scyte_network* net, uint64_t seed);
 void scyte_train_network(scyte_network* net, scyte_optimizer_params params, int batch_size, int num_epochs, float val_split, int early_stop_patience, scyte_data data);
 const float* scyte_predict_network(scyte_network* net, float* data);
 
+// Compiles a copy of a network for inference, see freeze.h: only the nodes the output depends on
+// are kept, the weights become constants and are folded where possible, and nothing has a delta.
+// The copy owns its weights, it can't be trained. Returns NULL if the network has no single output
+scyte_network* scyte_freeze_network(const scyte_network* net);
+
+// An inference session owns the activations and scratch buffers of one request at a time, and
+// reads the weights of the network it was made from. Threads can thereby serve one network
+// concurrently with a session each, as long as the network's weights don't change meanwhile.
+typedef struct {
+    const scyte_network* net;
+    int n;
+    scyte_node** nodes; // clone of the network's graph
+    float* arena;       // memory planned values of the op-nodes
+    int batch_size;
+    int out_idx;
+    scyte_exec_plan* exec; // forward pass to the output
+} scyte_session;
+
+scyte_session* scyte_make_session(const scyte_network* net);
+void scyte_free_session(scyte_session* session);
+// runs a batch of inputs through the session, returns the values of the output node
+const float* scyte_session_predict(scyte_session* session, int batch_size, float* data);
+
+// frozen networks are saved with scyte_save_frozen_network
 void scyte_save_network(const char* filename, scyte_network* net);
+// loads a network saved with scyte_save_network, scyte_save_mappable_network or scyte_save_frozen_network
 scyte_network* scyte_load_network(const char* filename);
 
+// saves a network in the versioned, mappable format, where the weights are page aligned
+void scyte_save_mappable_network(const char* filename, scyte_network* net);
+// maps the weights of a network saved with scyte_save_mappable_network or scyte_save_frozen_network
+// read-only instead of reading them, so processes mapping the same model share one copy. the
+// network can't be trained
+scyte_network* scyte_mmap_network(const char* filename);
+
+// saves a frozen network in its own format, laid out like the mappable one with the constants
+// only, so it can be loaded or mapped the same way
+void scyte_save_frozen_network(const char* filename, scyte_network* net);
+
 #endif
@@ -32,6 +32,13 @@
 #include "ops/l1_norm.h"
 #include "ops/maxpool2d.h"
 #include "ops/conv2d.h"
+#include "ops/layout_transform.h"
+#include "ops/avgpool2d.h"
+#include "ops/global_avgpool2d.h"
+#include "ops/fused_elementwise.h"
+#include "ops/transpose.h"
+#include "ops/softmax_xent.h"
+#include "ops/sigmoid_xent.h"
 
 scyte_node* make_op_node(scyte_op_type type, int num_dims, int num_children);
 scyte_node* make_op1_node(scyte_op_type type, scyte_node* x);
@@ -47,6 +54,24 @@ void (*scyte_get_backward_function(scyte_op_type op_type)) (struct scyte_node*);
 
 int (*scyte_get_resync_function(scyte_op_type op_type)) (struct scyte_node*);
 
+// Views are op-nodes that use the memory of their children instead of buffers of their own:
+// reshapes, slices of the first axis, selects whose children all have gradients or none do, and
+// the transposes scyte_sync_views doesn't pack. Their forward pass points their values and delta into the child, and their consumers accumulate
+// gradients straight into the child's delta. They're never allocated, nor planned, see planner.h
+int scyte_is_view(const scyte_node* node);
+// whether an op-node reads its i-th child as it's laid out, even if that's strided
+int scyte_reads_strided(const scyte_node* node, int i);
+// whether an op-node accumulates into the delta of its i-th child when it has one. Gradients only
+// flow along those edges, the children a node reads values from alone aren't backpropagated through
+int scyte_backprops_into(const scyte_node* node, int i);
+// The trans flag a gemm reads a matrix node with: 0 if it's contiguous, 1 if it's the transposed
+// view of a contiguous matrix, -1 if it's strided otherwise
+int scyte_matrix_trans(const scyte_node* node);
+// Copies the row-major elements [first, first + n) of a node out of memory laid out with the given
+// strides, or adds them back into it
+void scyte_gather_strided(const scyte_node* node, const int* strides, const float* src, int first, int n, float* dst);
+void scyte_scatter_add_strided(const scyte_node* node, const int* strides, const float* src, int first, int n, float* dst);
+
 // shape0 is product of all shapes before axis,
 // while shape1 is product of all shapes after axis
 void get_reduced_dimensions(scyte_node* node, int axis, int* shape0, int* shape1);
@@ -0,0 +1,14 @@
+#ifndef AVGPOOL2D_H
+#define AVGPOOL2D_H
+
+#include "scyte.h"
+
+// averages the windows over their elements inside x, the padding doesn't count
+scyte_node* scyte_avgpool2d(scyte_node* x, int size, int stride, int padding);
+
+int scyte_avgpool2d_sync_dims(scyte_node* node);
+
+void scyte_avgpool2d_forward(scyte_node* node);
+void scyte_avgpool2d_backward(scyte_node* node);
+
+#endif
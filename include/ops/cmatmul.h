@@ -7,6 +7,13 @@
 scyte_node* scyte_cmatmul(scyte_node* x, scyte_node* y);
 
 int scyte_cmatmul_sync_dims(scyte_node* node);
+// x and y may be transposed matrices, see scyte_matrix_trans
+int scyte_cmatmul_reads_strided(const scyte_node* node, int i);
+
+// Fuses the bias add and activation that follow the gemm into it, see fusion.h: the bias becomes a
+// third child, with one element per column of Z, and the activation the node's params
+int scyte_set_cmatmul_epilogue(scyte_node* node, scyte_node* bias, scyte_activation act);
+scyte_activation scyte_get_cmatmul_activation(const scyte_node* node);
 
 void scyte_cmatmul_forward(scyte_node* node);
 void scyte_cmatmul_backward(scyte_node* node);
@@ -3,9 +3,35 @@
 
 #include "scyte.h"
 
+#include <stddef.h>
+
+typedef enum {
+    SCYTE_CONV_AUTO = 0,        // times the algorithms on the first forward pass and keeps the fastest
+    SCYTE_CONV_GEMM,            // im2col followed by a gemm
+    SCYTE_CONV_DIRECT,
+    SCYTE_CONV_WINOGRAD_2X2,    // Winograd F(2x2,3x3), 3x3 filters with stride 1 only
+    SCYTE_CONV_WINOGRAD_4X4,    // Winograd F(4x4,3x3), 3x3 filters with stride 1 only
+} scyte_conv_algo;
+
 scyte_node* scyte_conv2d(scyte_node* x, scyte_node* w, int stride, int padding);
 
 int scyte_conv2d_sync_dims(scyte_node* node);
+// Limits the im2col workspace of each conv node, 64MB by default. The images of a minibatch are
+// convolved in chunks that fit the workspace, each with a single gemm. With OpenMP, minibatches of
+// at least one image per thread are spread over the threads instead, if the columns of every
+// thread fit the workspace.
+void scyte_set_conv_workspace_limit(size_t bytes);
+
+// The algorithm of the forward pass is part of the node's params, so it is saved with the network.
+// The backward pass always uses implicit gemms.
+const char* scyte_conv_algo_string(scyte_conv_algo algo);
+int scyte_conv_algo_supported(scyte_conv_algo algo, int size, int stride);
+scyte_conv_algo scyte_get_conv_algo(const scyte_node* node);
+// returns 0 if the algorithm doesn't support the node's filter size or stride
+int scyte_set_conv_algo(scyte_node* node, scyte_conv_algo algo);
+// The activation fused into the output by scyte_fuse_graph, also part of the params
+scyte_activation scyte_get_conv_activation(const scyte_node* node);
+void scyte_set_conv_activation(scyte_node* node, scyte_activation act);
 
 void scyte_conv2d_forward(scyte_node* node);
 void scyte_conv2d_backward(scyte_node* node);
@@ -0,0 +1,25 @@
+#ifndef FUSED_ELEMENTWISE_H
+#define FUSED_ELEMENTWISE_H
+
+#include "scyte.h"
+
+// the most inputs plus instructions of a fused op
+#define SCYTE_FUSED_MAX_REGS 32
+
+// A chain of elementwise ops run as a single loop over chunks of the output. The program is a list of
+// num_instrs instructions { op_type, a, b }, each an ADD, SUB, MULTIPLY, SQUARE, EXP, SIGMOID, TANH
+// or RELU of the registers a and b (the unary ops ignore b, set it to a). Registers [0, n) are the inputs,
+// register n + k is the result of instruction k, and the last instruction is the output. Inputs
+// smaller than the largest one are repeated over it, like the operands of add, sub and multiply,
+// and strided inputs, like transposes, are read in place.
+// The backward pass recomputes the intermediate results chunk by chunk instead of storing them
+scyte_node* scyte_fused_elementwise(int n, scyte_node** inputs, int num_instrs, const int* program);
+
+int scyte_fused_elementwise_sync_dims(scyte_node* node);
+// the program of a fused node, 3 ints per instruction
+const int* scyte_fused_elementwise_program(const scyte_node* node, int* num_instrs);
+
+void scyte_fused_elementwise_forward(scyte_node* node);
+void scyte_fused_elementwise_backward(scyte_node* node);
+
+#endif
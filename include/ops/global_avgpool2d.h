@@ -0,0 +1,14 @@
+#ifndef GLOBAL_AVGPOOL2D_H
+#define GLOBAL_AVGPOOL2D_H
+
+#include "scyte.h"
+
+// averages every plane of x into a single value, the output has shape N x C x 1 x 1
+scyte_node* scyte_global_avgpool2d(scyte_node* x);
+
+int scyte_global_avgpool2d_sync_dims(scyte_node* node);
+
+void scyte_global_avgpool2d_forward(scyte_node* node);
+void scyte_global_avgpool2d_backward(scyte_node* node);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef LAYOUT_TRANSFORM_H
+#define LAYOUT_TRANSFORM_H
+
+#include "scyte.h"
+
+// reorders a 4-d tensor into another layout, see layout.h
+scyte_node* scyte_layout_transform(scyte_node* x, scyte_layout layout);
+
+int scyte_layout_transform_sync_dims(scyte_node* node);
+
+void scyte_layout_transform_forward(scyte_node* node);
+void scyte_layout_transform_backward(scyte_node* node);
+
+#endif
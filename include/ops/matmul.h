@@ -6,6 +6,8 @@
 scyte_node* scyte_matmul(scyte_node* x, scyte_node* y);
 
 int scyte_matmul_sync_dims(scyte_node* node);
+// the inputs may be transposed matrices, see scyte_matrix_trans
+int scyte_matmul_reads_strided(const scyte_node* node, int i);
 
 void scyte_matmul_forward(scyte_node* node);
 void scyte_matmul_backward(scyte_node* node);
@@ -7,6 +7,12 @@ scyte_node* scyte_maxpool2d(scyte_node* x, int size, int stride, int padding);
 
 int scyte_maxpool2d_sync_dims(scyte_node* node);
 
+// By default the forward pass stores the index of the max of every window in node->tmp, as many ints
+// as there are outputs. Recomputing finds the max again in the backward pass instead, which saves
+// that memory for the price of a second pass over the input. The option is part of the node's params
+int scyte_maxpool2d_recomputes(const scyte_node* node);
+void scyte_set_maxpool2d_recompute(scyte_node* node, int recompute);
+
 void scyte_maxpool2d_forward(scyte_node* node);
 void scyte_maxpool2d_backward(scyte_node* node);
 
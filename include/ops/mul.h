@@ -3,6 +3,7 @@
 
 #include "scyte.h"
 
+// x * y, broadcast by numpy rules, see broadcast.h
 scyte_node* scyte_mul(scyte_node* x, scyte_node* y);
 
 int scyte_mul_sync_dims(scyte_node* node);
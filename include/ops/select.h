@@ -9,6 +9,7 @@ scyte_node* scyte_select(int node_idx, int n, scyte_node** nodes);
 scyte_node* scyte_dynamic_select(int n, scyte_node** nodes);
 
 int scyte_select_sync_dims(scyte_node* node);
+int scyte_select_is_view(const scyte_node* node);
 
 void scyte_select_forward(scyte_node* node);
 void scyte_select_backward(scyte_node* node);
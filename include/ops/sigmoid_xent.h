@@ -0,0 +1,15 @@
+#ifndef SIGMOID_XENT_H
+#define SIGMOID_XENT_H
+
+#include "scyte.h"
+
+// binary cross-entropy of pred = sigmoid(logits), computed from the logits and backpropagated
+// straight into them as pred - truth, like scyte_softmax_x_entropy. pred must be a sigmoid node
+scyte_node* scyte_sigmoid_x_entropy(scyte_node* truth, scyte_node* pred);
+
+int scyte_sigmoid_x_entropy_sync_dims(scyte_node* node);
+
+void scyte_sigmoid_x_entropy_forward(scyte_node* node);
+void scyte_sigmoid_x_entropy_backward(scyte_node* node);
+
+#endif
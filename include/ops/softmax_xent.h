@@ -0,0 +1,17 @@
+#ifndef SOFTMAX_XENT_H
+#define SOFTMAX_XENT_H
+
+#include "scyte.h"
+
+// Multi-class cross-entropy of pred = softmax(logits), computed from the logits instead of log(pred)
+// and backpropagated straight into them as pred*sum(truth) - truth per row, which is pred - truth for
+// one-hot targets, never through pred and its softmax. pred must be a softmax node, it's a child only
+// to be kept in the graph, and for its values, see scyte_backprops_into
+scyte_node* scyte_softmax_x_entropy(scyte_node* truth, scyte_node* pred);
+
+int scyte_softmax_x_entropy_sync_dims(scyte_node* node);
+
+void scyte_softmax_x_entropy_forward(scyte_node* node);
+void scyte_softmax_x_entropy_backward(scyte_node* node);
+
+#endif
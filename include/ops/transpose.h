@@ -0,0 +1,21 @@
+#ifndef TRANSPOSE_H
+#define TRANSPOSE_H
+
+#include "scyte.h"
+
+// Permutes the axes of x, axis i of the output is axis perm[i] of x, or reverses them if perm is
+// NULL. The output is a strided view of x (see scyte_is_view), which gemms read through their trans
+// flags and fused elementwise ops element by element, without copying. It's packed into a buffer of
+// its own by scyte_sync_views when any of its consumers only reads contiguous nodes, or when it's
+// an output or a cost
+scyte_node* scyte_transpose(scyte_node* x, const int* perm);
+
+int scyte_transpose_sync_dims(scyte_node* node);
+int scyte_transpose_is_view(const scyte_node* node);
+// packs the transpose, or makes it a view again, and syncs its strides
+void scyte_set_transpose_packed(scyte_node* node, int packed);
+
+void scyte_transpose_forward(scyte_node* node);
+void scyte_transpose_backward(scyte_node* node);
+
+#endif
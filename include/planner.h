@@ -0,0 +1,32 @@
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include "scyte.h"
+
+#include <stddef.h>
+
+// modes for the memory planner
+#define SCYTE_PLAN_PREDICT  0x1 // forward pass only, values are released once their last consumer has run
+#define SCYTE_PLAN_TRAIN    0x2 // forward and backward pass, deltas reuse the memory of values no longer needed
+// Added to either mode: the lifetimes are counted in levels of the graph as well as in nodes, so
+// the independent branches a scheduler runs side by side don't share memory, see scheduler.h
+#define SCYTE_PLAN_CONCURRENT 0x4
+
+typedef struct {
+    int mode;
+    int n;                  // number of nodes the plan was made for
+    size_t size;            // number of floats needed by the arena
+    long* val_offsets;      // offset of nodes[i]->vals in the arena, -1 if not planned
+    long* delta_offsets;    // offset of nodes[i]->delta in the arena, -1 if not planned
+} scyte_memory_plan;
+
+// Computes a static memory plan for the values and deltas of the op-nodes in a topologically
+// sorted graph. Buffers whose lifetimes don't overlap are assigned to the same region of one arena.
+scyte_memory_plan scyte_plan_memory(int n, scyte_node** nodes, int mode);
+// points the vals and deltas of the planned op-nodes into the arena
+void scyte_bind_memory(int n, scyte_node** nodes, const scyte_memory_plan* plan, float* arena);
+// releases the per-node buffers of the op-nodes, so they can be bound to an arena instead
+void scyte_release_op_buffers(int n, scyte_node** nodes);
+void scyte_free_memory_plan(scyte_memory_plan* plan);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include "scyte.h"
+
+typedef enum {
+    SCYTE_POOL_MAX = 0,
+    SCYTE_POOL_AVG,
+} scyte_pool_type;
+
+// A pooling window of size_h x size_w, moved by stride over the input padded by padding in total,
+// half of it before the first row and column. Average windows are divided by the number of their
+// elements inside the input, the padding is never part of a window
+typedef struct {
+    scyte_pool_type type;
+    int size_h, size_w, stride, padding;
+} scyte_pool;
+
+// sets the NCHW shape and the layout of the pooled node, returns 0 if x can't be pooled
+int scyte_pool_sync_dims(const scyte_pool* pool, const scyte_node* x, scyte_node* node);
+
+// Pools x into y in any layout. For max pools, the offset in x of the max of every window is stored
+// in indexes unless it is NULL, -1 for windows entirely in the padding
+void scyte_pool_forward(const scyte_pool* pool, const scyte_node* x, scyte_node* y, int* indexes);
+// Accumulates the gradient of y into x. Without indexes, max pools find the max of every window
+// again, the first element of the window equal to the output in row-major order
+void scyte_pool_backward(const scyte_pool* pool, scyte_node* x, const scyte_node* y, const int* indexes);
+
+#endif
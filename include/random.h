@@ -0,0 +1,36 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <stdint.h>
+
+// xoshiro256** generator. unlike rand() it keeps no hidden global state, so every thread can
+// own one without locking, and a stream is reproduced exactly by seeding it with the same value
+typedef struct {
+    uint64_t s[4];
+} scyte_rng;
+
+// seeds the generator through splitmix64, so any value (including 0) is a good seed
+void scyte_rng_seed(scyte_rng* rng, uint64_t seed);
+uint64_t scyte_rng_next(scyte_rng* rng);
+// uniform in [0, n)
+uint32_t scyte_rng_bounded(scyte_rng* rng, uint32_t n);
+// uniform in [min, max)
+float scyte_rng_uniform(scyte_rng* rng, float min, float max);
+// fisher-yates shuffle
+void scyte_rng_shuffle(scyte_rng* rng, int n, int* a);
+
+// generator of the calling thread. it is seeded on first use, from the seed set with
+// scyte_seed_thread_rngs and the thread's stream id
+scyte_rng* scyte_thread_rng();
+// reseeds the generators of all threads on their next use. not to be called while they're in use
+void scyte_seed_thread_rngs(uint64_t seed);
+// Sets the stream id of the calling thread and reseeds its generator on its next use, so that what
+// a thread draws doesn't depend on the order the threads first used theirs. Replicas pass their
+// index, threads that never call it draw from stream 0
+void scyte_seed_thread_rng(uint64_t id);
+// makes the calling thread draw from rng, or from its own generator if NULL, and returns the one it
+// drew from before (NULL for its own). the scheduler gives each step its own stream this way, so it
+// doesn't matter which thread runs it
+scyte_rng* scyte_swap_thread_rng(scyte_rng* rng);
+
+#endif
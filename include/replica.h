@@ -0,0 +1,45 @@
+#ifndef REPLICA_H
+#define REPLICA_H
+
+#include "scyte.h"
+
+#include <pthread.h>
+
+// a copy of a network's graph with its own activations and gradients, see scyte_copy_graph
+typedef struct {
+    int n;
+    scyte_node** nodes;
+    float* arena;       // memory planned values and deltas of the op-nodes
+    float* deltas;      // collated deltas of the variables
+    int batch_size;     // batch size the replica is currently planned for
+    int num_samples;    // size of this replica's slice of the minibatch, 0 if idle
+    int offset;         // first sample of the minibatch handled by this replica
+    float cost;
+    scyte_exec_plan* forward, *backward; // passes to and from the cost
+} scyte_replica;
+
+// Data-parallel replicas of a network. Every minibatch is split across the replicas, each run by
+// its own thread, after which their gradients are reduced into net->deltas.
+typedef struct {
+    scyte_network* net;
+    int num_replicas;
+    int num_vars;
+    int cost_idx;
+    scyte_replica* replicas;
+    pthread_t* threads;         // worker threads for replicas 1..num_replicas-1, 0 runs on the caller
+    pthread_barrier_t barrier;
+    int stop;
+    // the minibatch being processed
+    int batch_size, calc_grads;
+    float* X, *y;
+} scyte_replicas;
+
+scyte_replicas* scyte_make_replicas(scyte_network* net, int num_replicas);
+void scyte_free_replicas(scyte_replicas* r);
+// copies the params of the network's op-nodes to the replicas, e.g. after switching propagation mode
+void scyte_sync_replica_params(scyte_replicas* r);
+// Runs a minibatch through the replicas and returns its cost. If calc_grads is set, net->deltas
+// holds the gradient of the whole minibatch afterwards, ready for one optimizer step.
+float scyte_run_replicas(scyte_replicas* r, int batch_size, float* X, float* y, int calc_grads);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include "random.h"
+
+// Samples indices without replacement, in a new order every epoch. The order of an epoch only
+// depends on the seed and the epoch number, so samplers with the same seed agree on it, e.g. the
+// shards of one dataset in different threads or processes.
+typedef struct {
+    int n;              // number of indices sampled from
+    int* pool;          // the indices sampled from
+    int* order;         // permutation of the pool for the current epoch
+    int shuffle;        // 0 keeps the pool's order every epoch
+    uint64_t seed;
+    int epoch, pos;     // current epoch, and position within this shard's part of it
+    int shard, num_shards, strided;
+} scyte_sampler;
+
+// samples from indices[0..n-1], or from 0..n-1 if indices is NULL
+scyte_sampler* scyte_make_sampler(int n, const int* indices, int shuffle, uint64_t seed);
+void scyte_free_sampler(scyte_sampler* s);
+// Restricts the sampler to one of num_shards disjoint parts of each epoch. Strided shards take
+// every num_shards'th index of the epoch, others a contiguous block of it. Restarts the epoch
+void scyte_shard_sampler(scyte_sampler* s, int shard, int num_shards, int strided);
+// restarts sampling at the beginning of the given epoch
+void scyte_set_sampler_epoch(scyte_sampler* s, int epoch);
+// number of indices in this shard's part of an epoch
+int scyte_sampler_epoch_size(const scyte_sampler* s);
+// returns the next index, moving on to the next epoch once the current one is exhausted
+int scyte_sampler_next(scyte_sampler* s);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "scyte.h"
+
+// Runs the steps of an exec plan on a pool of threads, each step as soon as the steps it depends
+// on are done, so that independent branches of a graph (e.g. the towers of an inception block, or
+// the gradients of the inputs of a concat) run concurrently. A step depends on every earlier step
+// whose memory it reads or writes, as bound when the plan runs:
+// - the values a step reads must have been written, and a buffer the memory planner shares between
+//   nodes is only reused once its last reader is done
+// - the gradients accumulated into the same delta are summed in the order of the sequential pass,
+//   so the results are exactly those of scyte_run_exec, whatever the number of threads
+// Every thread owns a queue of ready steps and steals from the others when its own runs dry. The
+// ops run single-threaded meanwhile, the threads are already busy with the branches.
+typedef struct scyte_scheduler scyte_scheduler;
+
+// the caller's thread is one of the num_threads
+scyte_scheduler* scyte_make_scheduler(int num_threads);
+void scyte_free_scheduler(scyte_scheduler* s);
+// Same as scyte_run_exec. The dependencies are computed on the plan's first run and kept with it,
+// they're computed again when the memory the nodes are bound to moves, e.g. for a new batch size
+const float* scyte_schedule_exec(scyte_scheduler* s, scyte_exec_plan* plan);
+
+// frees the dependencies kept with a plan
+void scyte_free_exec_deps(scyte_exec_deps* deps);
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef SCYTE_H
 #define SCYTE_H
 
+#include <stdint.h>
 #include <stdio.h>
 
 #define SCYTE_MAX_DIMS 4
@@ -56,8 +57,33 @@ typedef enum {
     NOP,
     MAXPOOL2D,
     CONV2D,
+    LAYOUT_TRANSFORM,
+    AVGPOOL2D,
+    GLOBAL_AVGPOOL2D,
+    FUSED_ELEMENTWISE,
+    TRANSPOSE,
+    SOFTMAX_XENT,
+    SIGMOID_XENT,
 } scyte_op_type;
 
+// activations fused into the output of a gemm or a convolution, see fusion.h
+typedef enum {
+    SCYTE_ACTIVATION_NONE = 0,
+    SCYTE_ACTIVATION_RELU,
+    SCYTE_ACTIVATION_SIGMOID,
+    SCYTE_ACTIVATION_TANH,
+} scyte_activation;
+
+// Memory layout of a 4-d tensor, whose shape is always given as NCHW. In the blocked layouts the
+// channels are split into blocks of 8 or 16, stored innermost, so that SIMD kernels can load the
+// same pixel of a whole block of channels at once. Operands are always NCHW, see layout.h
+typedef enum {
+    SCYTE_NCHW = 0,
+    SCYTE_NHWC,
+    SCYTE_NCHW8C,
+    SCYTE_NCHW16C,
+} scyte_layout;
+
 typedef struct scyte_node {
     scyte_node_type type; // type of node – var, const, etc.
     scyte_op_type op_type; // type of operation – add, multiply, subtract, etc.
@@ -67,6 +93,8 @@ typedef struct scyte_node {
 
     unsigned    num_dims;
     int         shape[SCYTE_MAX_DIMS];
+    scyte_layout layout; // derived from the children when the dims are synced
+    int         strides[SCYTE_MAX_DIMS]; // in elements, all zero if the node is contiguous, see scyte_is_contiguous
 
     float*      vals;   // stored values for node
     float*      delta;  // deltas provided by the output/top nodes
@@ -81,12 +109,49 @@ typedef struct scyte_node {
     struct scyte_node** children;
 } scyte_node;
 
+// A forward pass to a node, or a backward pass from it, compiled into the op-nodes it runs in order,
+// instead of finding them on every call like scyte_forward and scyte_backward do. The steps of a
+// backward pass first clear the deltas of the children they're the first to accumulate into, and
+// skip the op-nodes without gradients. Views (see scyte_is_view) aren't steps, they're bound to
+// their children's memory before the steps run. A plan stays valid until the graph changes, the
+// batch size and the memory the nodes are bound to may change in between
+typedef struct {
+    void (*run)(struct scyte_node*);
+    scyte_node* node;
+    int num_cleared; // number of deltas cleared before running the step
+} scyte_exec_step;
+
+typedef struct scyte_exec_deps scyte_exec_deps;
+
+typedef struct scyte_exec_plan {
+    int backward;
+    scyte_node* target;
+    int num_steps;
+    scyte_exec_step* steps;
+    scyte_node** cleared; // the nodes whose deltas are cleared, in the order of the steps
+    int num_views;
+    scyte_node** views;   // the views the steps read, in order
+    scyte_exec_deps* deps; // dependencies between the steps, kept by the scheduler, see scheduler.h
+} scyte_exec_plan;
+
 typedef struct {
     int n;              // number of nodes in the network
     scyte_node** nodes; // array of the nodes in the network
     float* vals;    // collated values
     float* deltas;  // collated deltas
     float* consts;  // collated constants
+    float* arena;   // memory planned values and deltas of the op-nodes, see planner.h
+    int plan_mode;  // the memory plan the arena is laid out for
+    void* mapped;   // read-only mapping of the weights, if loaded with scyte_mmap_network
+    size_t mapped_size;
+    int num_threads; // number of data-parallel replicas used for training
+    int frozen;     // compiled for inference only, see scyte_freeze_network
+    // the passes run by predicting and training, compiled on first use and dropped when the graph changes
+    scyte_exec_plan* predict_exec, *cost_exec, *grad_exec;
+    struct scyte_scheduler* scheduler; // runs independent branches concurrently, see scheduler.h
+    // applied to the training batches, see scyte_augment_fn in data.h
+    void (*augment)(int batch_size, float* X, float* y, int x_cols, int y_cols);
+    uint64_t seed;  // seeds the data split, the samplers and the thread generators of training
 } scyte_network;
 
 // node->vals are set to fill_val if num_dims <= 1
@@ -98,24 +163,47 @@ scyte_node* scyte_weight(int rows, int cols);
 
 
 // find index of node with certain type
-int scyte_find_node(scyte_network* net, scyte_node_type type);
+int scyte_find_node(const scyte_network* net, scyte_node_type type);
 // feed placeholders in a net of a certain type with given vals
 int scyte_feed_net(scyte_network* net, scyte_node_type type, float** vals);
 // feed a single placeholder
 void scyte_feed_placeholder(scyte_node* node, float* vals);
 
 void scyte_set_batch_size(int n, scyte_node** nodes, int batch_size);
+// only updates the shapes for a new batch size, without allocating. returns the old batch size
+int scyte_resync_batch_size(int n, scyte_node** nodes, int batch_size);
 scyte_node** scyte_make_graph(int* num_nodes, int num_roots, scyte_node** roots);
 void scyte_free_graph(int n, scyte_node** nodes);
+// Copies a graph at the given batch size. The copy has its own params, values, deltas and scratch
+// buffers for the op-nodes, while its variables and constants alias the values of the original.
+// The deltas of the variables are left NULL, for the owner of the copy to bind.
 scyte_node** scyte_copy_graph(int n, scyte_node** nodes, int batch_size);
 
+// copies the shape and the layout, the copy is contiguous
 void scyte_copy_shape(const scyte_node* src, scyte_node* dst);
+// the strides of a node, those of its row-major layout if it's contiguous
+void scyte_get_strides(const scyte_node* node, int strides[SCYTE_MAX_DIMS]);
+// number of floats from the first to the last element of a node, more than its size if it's strided
+int scyte_span(const scyte_node* node);
+// Decides which strided views (see ops/transpose.h) stay views: those whose consumers all read
+// strided inputs and that aren't outputs or costs. The others are packed into buffers of their own,
+// which are left NULL for the caller to allocate. Run on every graph made, copied or loaded, and
+// again after fusion, which changes the consumers
+void scyte_sync_views(int n, scyte_node** nodes);
 void scyte_fill_vals(scyte_node* node, float fill_val);
 
 // returns a pointer to nodes[to]->vals
 const float* scyte_forward(int n, scyte_node** nodes, int to);
 void scyte_backward(int n, scyte_node** nodes, int from);
 
+// compiles the forward pass to nodes[target], or the backward pass from it, see scyte_exec_plan
+scyte_exec_plan* scyte_compile_exec(int n, scyte_node** nodes, int target, int backward);
+// runs a plan, returns the values of its target after a forward pass, its delta after a backward pass
+const float* scyte_run_exec(const scyte_exec_plan* plan);
+// points the views of a plan into the memory of their children, as scyte_run_exec does first
+void scyte_bind_exec_views(const scyte_exec_plan* plan);
+void scyte_free_exec(scyte_exec_plan* plan);
+
 void scyte_print_graph(int n, scyte_node** nodes);
 void scyte_save_graph(FILE* fp, int num_nodes, scyte_node** nodes);
 scyte_node** scyte_load_graph(FILE* fp, int* n);
@@ -129,4 +217,14 @@ static inline int scyte_num_elements(scyte_node* node)
     return n;
 }
 
+// Nodes are stored row-major unless they're strided views of their children, like transposes. Most
+// ops only read contiguous nodes, those that read strided ones are listed in scyte_reads_strided
+static inline int scyte_is_contiguous(const scyte_node* node)
+{
+    for(int i = 0; i < node->num_dims; ++i) {
+        if(node->strides[i]) return 0;
+    }
+    return 1;
+}
+
 #endif
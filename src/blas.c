@@ -1,7 +1,162 @@
 #include "blas.h"
+#include "blas_kernels.h"
 
 #include <math.h>
+#include <stdlib.h>
 #include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static const blas_kernels* kernels = &blas_kernels_generic;
+
+// picks the fastest kernels the host supports, runs once at startup.
+// SCYTE_ISA=generic|sse4.2|avx2|avx512 can be set to force a slower set of kernels
+__attribute__((constructor)) static void blas_select_kernels()
+{
+    const blas_kernels* candidates[4] = { &blas_kernels_generic };
+    int num_supported = 1;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("sse4.2")) {
+        candidates[num_supported++] = &blas_kernels_sse42;
+        if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            candidates[num_supported++] = &blas_kernels_avx2;
+            if(__builtin_cpu_supports("avx512f")) candidates[num_supported++] = &blas_kernels_avx512;
+        }
+    }
+#endif
+    kernels = candidates[num_supported-1];
+    const char* isa = getenv("SCYTE_ISA");
+    if(!isa) return;
+    for(int i = 0; i < num_supported; ++i) {
+        if(strcmp(isa, candidates[i]->name) == 0) kernels = candidates[i];
+    }
+}
+
+const char* blas_get_isa()
+{
+    return kernels->name;
+}
+
+// blocking parameters for the packed gemm, chosen so that a MC x KC panel of A
+// stays in L2 and a KC x NR sliver of B stays in L1. MC is a multiple of every
+// micro-kernel's MR, the MR x NR register tile itself depends on the selected kernels
+#define GEMM_MC 144
+#define GEMM_KC 256
+#define GEMM_NC 2048
+
+// below this many multiply-adds packing costs more than it saves
+#define GEMM_SMALL 4096
+
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+
+// element (i,j) of op(X), where X is stored row-major with leading dimension ld
+#define GEMM_ELEM(X, trans, ld, i, j) ((trans) ? (X)[(j)*(ld) + (i)] : (X)[(i)*(ld) + (j)])
+
+// packs a panel of a strided matrix op(X), see gemm_panel_fn
+void gemm_pack_rows(const void* ctx, int first, int k0, int n, int kc, int width, float* packed)
+{
+    const gemm_matrix* m = (const gemm_matrix*)ctx;
+    for(int k = 0; k < kc; ++k) {
+        int r;
+        for(r = 0; r < n; ++r) packed[r] = GEMM_ELEM(m->X, m->trans, m->ld, first + r, k0 + k);
+        for(; r < width; ++r) packed[r] = 0.f;
+        packed += width;
+    }
+}
+
+void gemm_pack_cols(const void* ctx, int first, int k0, int n, int kc, int width, float* packed)
+{
+    const gemm_matrix* m = (const gemm_matrix*)ctx;
+    for(int k = 0; k < kc; ++k) {
+        int r;
+        for(r = 0; r < n; ++r) packed[r] = GEMM_ELEM(m->X, m->trans, m->ld, k0 + k, first + r);
+        for(; r < width; ++r) packed[r] = 0.f;
+        packed += width;
+    }
+}
+
+// multiplies a packed mc x kc block of A with a packed kc x nc block of B into C
+static inline void gemm_macro_kernel(int mc, int nc, int kc, float alpha,
+        const float* packed_a, const float* packed_b, float* C, int ldc)
+{
+    const int MR = kernels->mr, NR = kernels->nr;
+    float c_edge[GEMM_MAX_MR*GEMM_MAX_NR];
+    for(int j = 0; j < nc; j += NR) {
+        int nr = MIN(NR, nc - j);
+        for(int i = 0; i < mc; i += MR) {
+            int mr = MIN(MR, mc - i);
+            const float* a = packed_a + i*kc, *b = packed_b + j*kc;
+            if(mr == MR && nr == NR) {
+                kernels->gemm_micro_kernel(kc, alpha, a, b, &C[i*ldc+j], ldc);
+                continue;
+            }
+            // partial tile at the border, compute into a scratch tile and copy back
+            memset(c_edge, 0, MR*NR*sizeof(float));
+            kernels->gemm_micro_kernel(kc, alpha, a, b, c_edge, NR);
+            for(int ir = 0; ir < mr; ++ir) {
+                for(int jr = 0; jr < nr; ++jr) {
+                    C[(i+ir)*ldc + j+jr] += c_edge[ir*NR + jr];
+                }
+            }
+        }
+    }
+}
+
+// The mc x kc blocks of A are packed into panels of MR rows, the kc x nc blocks of B into panels
+// of NR columns, each stored depth by depth and zero-padded, so the micro-kernel never has to
+// check bounds. The blocks of A are spread over the threads, in smaller blocks if A has few rows
+static void gemm_packed(int M, int N, int K, float alpha,
+        gemm_panel_fn pack_a, const void* ctx_a,
+        gemm_panel_fn pack_b, const void* ctx_b,
+        float* C, int ldc)
+{
+    const int MR = kernels->mr, NR = kernels->nr;
+    int nc_max = MIN(N, GEMM_NC), kc_max = MIN(K, GEMM_KC);
+    int nc_pad = (nc_max + NR - 1) / NR * NR;
+    float* packed_b = (float*)aligned_alloc(64, (nc_pad*kc_max*sizeof(float) + 63) & ~(size_t)63);
+    int mc_step = GEMM_MC;
+#ifdef _OPENMP
+    // inside a parallel region, e.g. one gemm per image of a batch, the gemm runs on a single thread
+    int num_threads = omp_in_parallel() ? 1 : omp_get_max_threads();
+    if(M < GEMM_MC*num_threads) {
+        mc_step = ((M + num_threads - 1) / num_threads + MR - 1) / MR * MR;
+        if(mc_step > GEMM_MC) mc_step = GEMM_MC;
+    }
+#endif
+
+    for(int jc = 0; jc < N; jc += GEMM_NC) {
+        int nc = MIN(GEMM_NC, N - jc);
+        for(int pc = 0; pc < K; pc += GEMM_KC) {
+            int kc = MIN(GEMM_KC, K - pc);
+            #pragma omp parallel for
+            for(int j = 0; j < nc; j += NR) {
+                pack_b(ctx_b, jc + j, pc, MIN(NR, nc - j), kc, NR, packed_b + j*kc);
+            }
+
+            #pragma omp parallel for
+            for(int ic = 0; ic < M; ic += mc_step) {
+                float packed_a[GEMM_MC*GEMM_KC] __attribute__((aligned(64)));
+                int mc = MIN(mc_step, M - ic);
+                for(int i = 0; i < mc; i += MR) {
+                    pack_a(ctx_a, ic + i, pc, MIN(MR, mc - i), kc, MR, packed_a + i*kc);
+                }
+                gemm_macro_kernel(mc, nc, kc, alpha, packed_a, packed_b, &C[ic*ldc + jc], ldc);
+            }
+        }
+    }
+    free(packed_b);
+}
+
+void gemm_panels_cpu(int M, int N, int K, float alpha,
+        gemm_panel_fn pack_a, const void* ctx_a,
+        gemm_panel_fn pack_b, const void* ctx_b,
+        float* C, int ldc)
+{
+    if(M <= 0 || N <= 0 || K <= 0 || alpha == 0.f) return;
+    gemm_packed(M, N, K, alpha, pack_a, ctx_a, pack_b, ctx_b, C, ldc);
+}
 
 #ifdef OPENBLAS
 
@@ -49,97 +204,21 @@ void scale_cpu(int n, float alpha, const float* x, float* y)
 
 #else
 
-#ifdef __AVX__
-#include <x86intrin.h>
-#include <ammintrin.h>
-#include <immintrin.h>
-#include <smmintrin.h>
-#endif
-
-static inline void gemm_nn(int M, int N, int K, float alpha,
-        const float* A, int lda,
-        const float* B, int ldb,
-        float* C, int ldc)
-{
-    int j;
-    #pragma omp parallel for
-    for(int i = 0; i < M; ++i) {
-        for(int k = 0; k < K; ++k) {
-            float a_part = alpha*A[i*lda+k];
-#ifdef __AVX__
-            __m256 a256, b256, b256_2, c256, c256_2, out256, out256_2;
-            a256 = _mm256_set1_ps(a_part);
-            for(j = 0; j < N >> 4 << 4; j += 16) {
-                b256 = _mm256_loadu_ps(&B[k*ldb + j]);
-                b256_2 = _mm256_loadu_ps(&B[k*ldb + (j+8)]);
-                c256 = _mm256_loadu_ps(&C[i*ldc + j]);
-                c256_2 = _mm256_loadu_ps(&C[i*ldc + (j+8)]);
-                out256 = _mm256_fmadd_ps(a256, b256, c256);
-                out256_2 = _mm256_fmadd_ps(a256, b256_2, c256_2);
-                _mm256_storeu_ps(&C[i*ldc + j], out256);
-                _mm256_storeu_ps(&C[i*ldc + (j+8)], out256_2);
-            }
-            for(; j < N; ++j) C[i*ldc+j] += a_part*B[k*ldb+j];
-#else
-            for(j = 0; j < N; ++j) {
-                C[i*ldc+j] += a_part*B[k*ldb+j];
-            }
-#endif
-        }
-    }
-}
-
-static inline void gemm_nt(int M, int N, int K, float alpha,
-        const float* A, int lda,
-        const float* B, int ldb,
-        float* C, int ldc)
-{
-    #pragma omp parallel for
-    for(int i = 0; i < M; ++i) {
-        for(int j = 0; j < N; ++j) {
-            float sum = 0;
-            for(int k = 0; k < K; ++k) {
-                sum += alpha*A[i*lda+k]*B[j*ldb + k];
-            }
-            C[i*ldc+j] += sum;
-        }
-    }
-}
-
-static inline void gemm_tn(int M, int N, int K, float alpha,
+static inline void gemm_small(int trans_a, int trans_b, int M, int N, int K, float alpha,
         const float* A, int lda,
         const float* B, int ldb,
         float* C, int ldc)
 {
-    #pragma omp parallel for
     for(int i = 0; i < M; ++i) {
         for(int k = 0; k < K; ++k) {
-            float a_part = alpha*A[k*lda+i];
+            float a_part = alpha*GEMM_ELEM(A, trans_a, lda, i, k);
             for(int j = 0; j < N; ++j) {
-                C[i*ldc+j] += a_part*B[k*ldb+j];
+                C[i*ldc+j] += a_part*GEMM_ELEM(B, trans_b, ldb, k, j);
             }
         }
     }
 }
 
-static inline void gemm_tt(int M, int N, int K, float alpha,
-            const float* A, int lda,
-            const float* B, int ldb,
-            float* C, int ldc)
-{
-    #pragma omp parallel for
-    for(int i = 0; i < M; ++i) {
-        for(int j = 0; j < N; ++j) {
-            float sum = 0;
-            for(int k = 0; k < K; ++k) {
-                sum += alpha*A[i+k*lda]*B[k+j*ldb];
-            }
-            C[i*ldc+j] += sum;
-        }
-    }
-}
-
-
 void gemm_cpu(int trans_a, int trans_b, int M, int N, int K,
         float alpha, const float* A, const float* B, float beta, float* C)
 {
@@ -147,14 +226,19 @@ void gemm_cpu(int trans_a, int trans_b, int M, int N, int K,
     int ldb = trans_b ? K : N;
     int ldc = N;
 
-    for(int i = 0; i < M*N; ++i) {
-        C[i] *= beta;
+    if(beta == 0.f) memset(C, 0, M*N*sizeof(float));
+    else if(beta != 1.f) {
+        for(int i = 0; i < M*N; ++i) {
+            C[i] *= beta;
+        }
     }
+    if(M <= 0 || N <= 0 || K <= 0 || alpha == 0.f) return;
 
-    if(!trans_a && !trans_b) gemm_nn(M, N, K, alpha, A, lda, B, ldb, C, ldc);
-    else if(trans_a && !trans_b) gemm_tn(M, N, K, alpha, A, lda, B, ldb, C, ldc);
-    else if(!trans_a && trans_b) gemm_nt(M, N, K, alpha, A, lda, B, ldb, C, ldc);
-    else gemm_tt(M, N, K, alpha, A, lda, B, ldb, C, ldc);
+    if((long)M*N*K <= GEMM_SMALL) gemm_small(trans_a, trans_b, M, N, K, alpha, A, lda, B, ldb, C, ldc);
+    else {
+        gemm_matrix a = { A, trans_a, lda }, b = { B, trans_b, ldb };
+        gemm_packed(M, N, K, alpha, gemm_pack_rows, &a, gemm_pack_cols, &b, C, ldc);
+    }
 }
 
 static inline void gemv_n(int M, int N, float alpha, 
@@ -195,59 +279,43 @@ void gemv_cpu(int trans_a, int M, int N, float alpha,
 
 void axpy_cpu(int N, float alpha, const float* X, float* Y)
 {
-    for(int i = 0; i < N; ++i) {
-        Y[i] += alpha*X[i];
-    }
+    kernels->axpy(N, alpha, X, Y);
 }
 
 void axpby_cpu(int N, float alpha, const float* X, float beta, float* Y)
 {
-    for(int i = 0; i < N; ++i) {
-        Y[i] = alpha*X[i] + beta*Y[i];
-    }
+    kernels->axpby(N, alpha, X, beta, Y);
 }
 
 void scale_cpu(int n, float alpha, const float* x, float* y)
 {
-    for(int i = 0; i < n; ++i) {
-        y[i] = alpha*x[i];
-    }
+    kernels->scale(n, alpha, x, y);
 }
 #endif
 
 void add_cpu(int n, const float* x, const float* y, float* z)
 {
-    for(int i = 0; i < n; ++i) {
-        z[i] = x[i] + y[i];
-    }
+    kernels->add(n, x, y, z);
 }
 
 void sub_cpu(int n, const float* x, const float* y, float* z)
 {
-    for(int i = 0; i < n; ++i) {
-        z[i] = x[i] - y[i];
-    }
+    kernels->sub(n, x, y, z);
 }
 
 void mul_cpu(int n, const float* x, const float* y, float* z)
 {
-    for(int i = 0; i < n; ++i) {
-        z[i] = x[i]*y[i];
-    }
+    kernels->mul(n, x, y, z);
 }
 
 void div_cpu(int n, const float* x, const float* y, float* z)
 {
-    for(int i = 0; i < n; ++i) {
-        z[i] = x[i]/y[i];
-    }
+    kernels->div(n, x, y, z);
 }
 
 void mul_sum_cpu(int n, const float* x, const float* y, float* z)
 {
-    for(int i = 0; i < n; ++i) {
-        z[i] += x[i]*y[i];
-    }
+    kernels->mul_sum(n, x, y, z);
 }
 
 void pow_cpu(int n, float alpha, const float* x, float* y)
@@ -259,9 +327,15 @@ void pow_cpu(int n, float alpha, const float* x, float* y)
 
 void bias_cpu(int n, float alpha, const float* x, float* y)
 {
-    for (int i = 0; i < n; ++i) {
-        y[i] = alpha + x[i];
-    }
+    kernels->bias(n, alpha, x, y);
+}
+
+void gemm_acc_cpu(int trans_a, int trans_b, int trans_c, int M, int N, int K,
+        float alpha, const float* A, const float* B, float* C)
+{
+    // C^T += alpha*op(B)^T*op(A)^T
+    if(trans_c) gemm_cpu(!trans_b, !trans_a, N, M, K, alpha, B, A, 1.f, C);
+    else gemm_cpu(trans_a, trans_b, M, N, K, alpha, A, B, 1.f, C);
 }
 
 void copy_cpu(int N, const float* X, float* Y)
@@ -272,16 +346,37 @@ void copy_cpu(int N, const float* X, float* Y)
 
 void exp_cpu(int n, const float* x, float* y)
 {
-    for (int i = 0; i < n; ++i) {
-        y[i] = expf(x[i]);
-    }
+    kernels->exp(n, x, y);
 }
 
 void abs_cpu(int n, const float* x, float* y)
 {
-    for (int i = 0; i < n; ++i) {
-        y[i] = fabsf(x[i]);
-    }
+    kernels->abs(n, x, y);
+}
+
+void log_cpu(int n, const float* x, float* y)
+{
+    kernels->log(n, x, y);
+}
+
+void tanh_cpu(int n, const float* x, float* y)
+{
+    kernels->tanh(n, x, y);
+}
+
+void sigmoid_cpu(int n, const float* x, float* y)
+{
+    kernels->sigmoid(n, x, y);
+}
+
+void sin_cpu(int n, const float* x, float* y)
+{
+    kernels->sin(n, x, y);
+}
+
+void cos_cpu(int n, const float* x, float* y)
+{
+    kernels->cos(n, x, y);
 }
 
 void set_cpu(int N, float alpha, float* y)
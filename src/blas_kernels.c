@@ -0,0 +1,383 @@
+// instruction-set specific blas kernels.
+// this file is compiled once per instruction set (see the Makefile), with
+// BLAS_KERNELS_NAME naming the exported table and the -m flags selecting the isa,
+// the plain loops are then auto-vectorized for the target by the compiler
+#include "blas_kernels.h"
+
+#include <math.h>
+
+#if defined(__AVX512F__) || (defined(__AVX2__) && defined(__FMA__))
+#include <immintrin.h>
+#endif
+
+#ifndef BLAS_KERNELS_NAME
+#define BLAS_KERNELS_NAME blas_kernels_generic
+#endif
+
+#if defined(__AVX512F__)
+#define BLAS_KERNELS_ISA "avx512"
+#define GEMM_MR 12
+#define GEMM_NR 32
+#elif defined(__AVX2__) && defined(__FMA__)
+#define BLAS_KERNELS_ISA "avx2"
+#define GEMM_MR 6
+#define GEMM_NR 16
+#elif defined(__SSE4_2__)
+#define BLAS_KERNELS_ISA "sse4.2"
+#define GEMM_MR 4
+#define GEMM_NR 8
+#else
+#define BLAS_KERNELS_ISA "generic"
+#define GEMM_MR 4
+#define GEMM_NR 8
+#endif
+
+#if defined(__AVX512F__)
+static void gemm_micro_kernel(int kc, float alpha, const float* a, const float* b, float* C, int ldc)
+{
+    __m512 c[GEMM_MR][2];
+    for(int i = 0; i < GEMM_MR; ++i) c[i][0] = c[i][1] = _mm512_setzero_ps();
+    for(int k = 0; k < kc; ++k) {
+        __m512 b0 = _mm512_loadu_ps(b), b1 = _mm512_loadu_ps(b + 16);
+        for(int i = 0; i < GEMM_MR; ++i) {
+            __m512 a512 = _mm512_set1_ps(a[i]);
+            c[i][0] = _mm512_fmadd_ps(a512, b0, c[i][0]);
+            c[i][1] = _mm512_fmadd_ps(a512, b1, c[i][1]);
+        }
+        a += GEMM_MR, b += GEMM_NR;
+    }
+    __m512 alpha512 = _mm512_set1_ps(alpha);
+    for(int i = 0; i < GEMM_MR; ++i) {
+        _mm512_storeu_ps(&C[i*ldc], _mm512_fmadd_ps(alpha512, c[i][0], _mm512_loadu_ps(&C[i*ldc])));
+        _mm512_storeu_ps(&C[i*ldc + 16], _mm512_fmadd_ps(alpha512, c[i][1], _mm512_loadu_ps(&C[i*ldc + 16])));
+    }
+}
+#elif defined(__AVX2__) && defined(__FMA__)
+static void gemm_micro_kernel(int kc, float alpha, const float* a, const float* b, float* C, int ldc)
+{
+    __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+    __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+    __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+    __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+    __m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+    __m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+    for(int k = 0; k < kc; ++k) {
+        __m256 b0 = _mm256_loadu_ps(b), b1 = _mm256_loadu_ps(b + 8), a256;
+        a256 = _mm256_broadcast_ss(a + 0); c00 = _mm256_fmadd_ps(a256, b0, c00); c01 = _mm256_fmadd_ps(a256, b1, c01);
+        a256 = _mm256_broadcast_ss(a + 1); c10 = _mm256_fmadd_ps(a256, b0, c10); c11 = _mm256_fmadd_ps(a256, b1, c11);
+        a256 = _mm256_broadcast_ss(a + 2); c20 = _mm256_fmadd_ps(a256, b0, c20); c21 = _mm256_fmadd_ps(a256, b1, c21);
+        a256 = _mm256_broadcast_ss(a + 3); c30 = _mm256_fmadd_ps(a256, b0, c30); c31 = _mm256_fmadd_ps(a256, b1, c31);
+        a256 = _mm256_broadcast_ss(a + 4); c40 = _mm256_fmadd_ps(a256, b0, c40); c41 = _mm256_fmadd_ps(a256, b1, c41);
+        a256 = _mm256_broadcast_ss(a + 5); c50 = _mm256_fmadd_ps(a256, b0, c50); c51 = _mm256_fmadd_ps(a256, b1, c51);
+        a += GEMM_MR, b += GEMM_NR;
+    }
+    __m256 alpha256 = _mm256_set1_ps(alpha);
+#define GEMM_STORE_ROW(i, r0, r1) \
+    _mm256_storeu_ps(&C[(i)*ldc], _mm256_fmadd_ps(alpha256, r0, _mm256_loadu_ps(&C[(i)*ldc]))); \
+    _mm256_storeu_ps(&C[(i)*ldc + 8], _mm256_fmadd_ps(alpha256, r1, _mm256_loadu_ps(&C[(i)*ldc + 8])));
+    GEMM_STORE_ROW(0, c00, c01); GEMM_STORE_ROW(1, c10, c11); GEMM_STORE_ROW(2, c20, c21);
+    GEMM_STORE_ROW(3, c30, c31); GEMM_STORE_ROW(4, c40, c41); GEMM_STORE_ROW(5, c50, c51);
+#undef GEMM_STORE_ROW
+}
+#else
+static void gemm_micro_kernel(int kc, float alpha, const float* a, const float* b, float* C, int ldc)
+{
+    float acc[GEMM_MR][GEMM_NR] = {{0}};
+    for(int k = 0; k < kc; ++k) {
+        for(int i = 0; i < GEMM_MR; ++i) {
+            for(int j = 0; j < GEMM_NR; ++j) {
+                acc[i][j] += a[i]*b[j];
+            }
+        }
+        a += GEMM_MR, b += GEMM_NR;
+    }
+    for(int i = 0; i < GEMM_MR; ++i) {
+        for(int j = 0; j < GEMM_NR; ++j) {
+            C[i*ldc+j] += alpha*acc[i][j];
+        }
+    }
+}
+#endif
+
+static void axpy(int n, float alpha, const float* x, float* y)
+{
+    for(int i = 0; i < n; ++i) {
+        y[i] += alpha*x[i];
+    }
+}
+
+static void axpby(int n, float alpha, const float* x, float beta, float* y)
+{
+    for(int i = 0; i < n; ++i) {
+        y[i] = alpha*x[i] + beta*y[i];
+    }
+}
+
+static void scale(int n, float alpha, const float* x, float* y)
+{
+    for(int i = 0; i < n; ++i) {
+        y[i] = alpha*x[i];
+    }
+}
+
+static void add(int n, const float* x, const float* y, float* z)
+{
+    for(int i = 0; i < n; ++i) {
+        z[i] = x[i] + y[i];
+    }
+}
+
+static void sub(int n, const float* x, const float* y, float* z)
+{
+    for(int i = 0; i < n; ++i) {
+        z[i] = x[i] - y[i];
+    }
+}
+
+static void mul(int n, const float* x, const float* y, float* z)
+{
+    for(int i = 0; i < n; ++i) {
+        z[i] = x[i]*y[i];
+    }
+}
+
+static void div_(int n, const float* x, const float* y, float* z)
+{
+    for(int i = 0; i < n; ++i) {
+        z[i] = x[i]/y[i];
+    }
+}
+
+static void mul_sum(int n, const float* x, const float* y, float* z)
+{
+    for(int i = 0; i < n; ++i) {
+        z[i] += x[i]*y[i];
+    }
+}
+
+static void bias(int n, float alpha, const float* x, float* y)
+{
+    for(int i = 0; i < n; ++i) {
+        y[i] = alpha + x[i];
+    }
+}
+
+
+static void abs_(int n, const float* x, float* y)
+{
+    for(int i = 0; i < n; ++i) {
+        y[i] = fabsf(x[i]);
+    }
+}
+
+// Transcendental functions as branch-free polynomials, after the cephes single precision ones,
+// so that the loops over them vectorize like the others. exp and log are within about 1 ulp of the
+// exact results, tanh, sigmoid, sin and cos within 4 ulp, counting the divisions -Ofast vectorizes
+// as a reciprocal and a newton step. exp flushes to 0 below -87.3 and overflows to inf above 88.7.
+// Special values are picked by selects, on the bits where -Ofast would fold the tests, so they're
+// the same in every build: NaN passes through, infinities and zeros give libm's results, denormal
+// outputs are flushed to 0 and log decodes denormal inputs from their bits.
+// The argument reductions subtract a constant split in parts, which only works in that order, so
+// -Ofast mustn't reassociate them
+#pragma GCC push_options
+#pragma GCC optimize("no-associative-math")
+
+static inline float float_from_bits(int i)
+{
+    union { int i; float f; } u = { .i = i };
+    return u.f;
+}
+
+static inline int float_to_bits(float f)
+{
+    union { float f; int i; } u = { .f = f };
+    return u.i;
+}
+
+// on the bits, -Ofast assumes there are no NaNs and folds x != x
+static inline int is_nan(float x)
+{
+    return (float_to_bits(x) & 0x7fffffff) > 0x7f800000;
+}
+
+#define MATH_EXP_MIN -87.33654f
+#define MATH_EXP_MAX 88.72283f
+#define MATH_LOG2E 1.44269504088896341f
+// ln(2) split in a part exact to 9 bits and the rest, so that n*ln(2) is exact for |n| < 2^15
+#define MATH_LN2_HI 0.693359375f
+#define MATH_LN2_LO -2.12194440e-4f
+
+// exp(x) = 2^n*exp(r), with x = n*ln(2) + r and |r| <= ln(2)/2
+static inline float exp_approx(float x)
+{
+    float xc = fminf(fmaxf(x, MATH_EXP_MIN), MATH_EXP_MAX);
+    // rounded by truncation, floorf isn't an instruction before sse4.1
+    float v = xc*MATH_LOG2E;
+    int e = (int)(v + (v < 0.f ? -0.5f : 0.5f));
+    float n = (float)e;
+    float r = xc - n*MATH_LN2_HI - n*MATH_LN2_LO;
+    float p = 1.9875691500e-4f;
+    p = p*r + 1.3981999507e-3f;
+    p = p*r + 8.3334519073e-3f;
+    p = p*r + 4.1665795894e-2f;
+    p = p*r + 1.6666665459e-1f;
+    p = p*r + 5.0000001201e-1f;
+    p = p*r*r + r + 1.f;
+    // 2^128 isn't a float, p is doubled instead
+    int top = e > 127;
+    p = top ? p + p : p;
+    p *= float_from_bits((e - top + 127) << 23);
+    return is_nan(x) ? x : x < MATH_EXP_MIN ? 0.f : x > MATH_EXP_MAX ? INFINITY : p;
+}
+
+// log(x) = e*ln(2) + log(m), with x = 2^e*m and sqrt(1/2) <= m < sqrt(2). A denormal x is its
+// mantissa times 2^-149, the mantissa is converted as an integer, the conversion never flushes it
+static inline float log_approx(float x)
+{
+    int bits = float_to_bits(x), abs_bits = bits & 0x7fffffff, denormal = abs_bits < 0x00800000;
+    int xs = denormal ? float_to_bits((float)abs_bits) : abs_bits;
+    float e = (float)(((xs >> 23) & 0xff) - (denormal ? 126 + 149 : 126));
+    float m = float_from_bits((xs & 0x007fffff) | 0x3f000000);
+    int small = m < 0.707106781186547524f;
+    e -= small ? 1.f : 0.f;
+    m = (small ? m + m : m) - 1.f;
+    float z = m*m;
+    float p = 7.0376836292e-2f;
+    p = p*m - 1.1514610310e-1f;
+    p = p*m + 1.1676998740e-1f;
+    p = p*m - 1.2420140846e-1f;
+    p = p*m + 1.4249322787e-1f;
+    p = p*m - 1.6668057665e-1f;
+    p = p*m + 2.0000714765e-1f;
+    p = p*m - 2.4999993993e-1f;
+    p = p*m + 3.3333331174e-1f;
+    p = p*m*z + e*MATH_LN2_LO - 0.5f*z;
+    float y = m + p + e*MATH_LN2_HI;
+    // -0 is a zero, -NaN stays a NaN, +inf and NaN pass through
+    return abs_bits == 0 ? -INFINITY : bits < 0 ? NAN : abs_bits >= 0x7f800000 ? x : y;
+}
+
+// tanh(x) = x + x^3*p(x^2) near 0, 1 - 2/(exp(2x) + 1) elsewhere
+static inline float tanh_approx(float x)
+{
+    float ax = fminf(fabsf(x), 9.f), z = x*x;
+    float p = -5.70498872745e-3f;
+    p = p*z + 2.06390887954e-2f;
+    p = p*z - 5.37397155531e-2f;
+    p = p*z + 1.33314422036e-1f;
+    p = p*z - 3.33332819422e-1f;
+    // with the sign bit of x, -Ofast doesn't keep the sign of -0 and flushed denormals
+    float near = float_from_bits(float_to_bits(p*z*x + x) | (float_to_bits(x) & 0x80000000));
+    float far = 1.f - 2.f/(exp_approx(2.f*ax) + 1.f);
+    // tanh rounds to 1 past 9, the reciprocal of the division mightn't
+    far = ax > 9.f ? 1.f : far;
+    far = x < 0.f ? -far : far;
+    return is_nan(x) ? x : ax < 0.625f ? near : far;
+}
+
+// The outputs below FLT_MIN, past -87.3, are flushed to 0. 0.5 and 1 are exact where sigmoid rounds
+// to them, which the reciprocal of the division mightn't be
+static inline float sigmoid_approx(float x)
+{
+    float y = 1.f/(1.f + exp_approx(-fminf(fmaxf(x, MATH_EXP_MIN), 88.f)));
+    y = fabsf(x) < 0x1p-24f ? 0.5f : y;
+    return is_nan(x) ? x : x < MATH_EXP_MIN ? 0.f : x > 17.4f ? 1.f : y;
+}
+
+#define MATH_FOUR_OVER_PI 1.27323954473516f
+// pi/4 in three parts, so that |x| - j*pi/4 keeps its precision for |x| <= MATH_SIN_MAX
+#define MATH_PI4_A 0.78515625f
+#define MATH_PI4_B 2.4187564849853515625e-4f
+#define MATH_PI4_C 3.77489497744594108e-8f
+// beyond this the reduction loses bits, libm takes over
+#define MATH_SIN_MAX 256.f
+
+// sin(x), or cos(x) = sin(|x| + pi/2): |x| = j*pi/4 + r with j even and |r| <= pi/4, j/2 is the
+// quadrant, which picks the sine or cosine polynomial of r and the sign
+static inline float sin_approx(float x, int cos)
+{
+    float ax = fabsf(x);
+    int j = ((int)(ax*MATH_FOUR_OVER_PI) + 1) & ~1;
+    float fj = (float)j;
+    float r = ((ax - fj*MATH_PI4_A) - fj*MATH_PI4_B) - fj*MATH_PI4_C, z = r*r;
+    j += cos ? 2 : 0;
+    float s = -1.9515295891e-4f;
+    s = s*z + 8.3321608736e-3f;
+    s = s*z - 1.6666654611e-1f;
+    s = s*z*r + r;
+    float c = 2.443315711809948e-5f;
+    c = c*z - 1.388731625493765e-3f;
+    c = c*z + 4.166664568298827e-2f;
+    c = c*z*z - 0.5f*z + 1.f;
+    float y = (j & 2) ? c : s;
+    // the sign of sin is the sign bit of x, so that sin(-0) = -0
+    int neg = ((j & 4) != 0) ^ (!cos && float_to_bits(x) < 0);
+    return neg ? -y : y;
+}
+
+static void exp_(int n, const float* x, float* y)
+{
+    for(int i = 0; i < n; ++i) {
+        y[i] = exp_approx(x[i]);
+    }
+}
+
+static void log_(int n, const float* x, float* y)
+{
+    for(int i = 0; i < n; ++i) {
+        y[i] = log_approx(x[i]);
+    }
+}
+
+static void tanh_(int n, const float* x, float* y)
+{
+    for(int i = 0; i < n; ++i) {
+        y[i] = tanh_approx(x[i]);
+    }
+}
+
+static void sigmoid(int n, const float* x, float* y)
+{
+    for(int i = 0; i < n; ++i) {
+        y[i] = sigmoid_approx(x[i]);
+    }
+}
+
+// the blocks with an element out of the polynomials' range go through libm
+#define MATH_SIN_BLOCK 64
+static void sin_cos(int n, const float* x, float* y, int cos)
+{
+    for(int first = 0; first < n; first += MATH_SIN_BLOCK) {
+        int m = n - first < MATH_SIN_BLOCK ? n - first : MATH_SIN_BLOCK, in_range = 1;
+        const float* xb = x + first;
+        float* yb = y + first;
+        for(int i = 0; i < m; ++i) in_range &= fabsf(xb[i]) <= MATH_SIN_MAX;
+        if(in_range) {
+            for(int i = 0; i < m; ++i) yb[i] = sin_approx(xb[i], cos);
+        }
+        else {
+            for(int i = 0; i < m; ++i) yb[i] = cos ? cosf(xb[i]) : sinf(xb[i]);
+        }
+    }
+}
+
+static void sin_(int n, const float* x, float* y)
+{
+    sin_cos(n, x, y, 0);
+}
+
+static void cos_(int n, const float* x, float* y)
+{
+    sin_cos(n, x, y, 1);
+}
+#pragma GCC pop_options
+
+const blas_kernels BLAS_KERNELS_NAME = {
+    .name = BLAS_KERNELS_ISA,
+    .mr = GEMM_MR, .nr = GEMM_NR,
+    .gemm_micro_kernel = gemm_micro_kernel,
+    .axpy = axpy, .axpby = axpby, .scale = scale,
+    .add = add, .sub = sub, .mul = mul, .div = div_, .mul_sum = mul_sum,
+    .bias = bias, .exp = exp_, .abs = abs_,
+    .log = log_, .tanh = tanh_, .sigmoid = sigmoid, .sin = sin_, .cos = cos_,
+};
@@ -0,0 +1,220 @@
+#include "broadcast.h"
+
+#include "blas.h"
+#include "logger.h"
+
+#include <string.h>
+
+// below this many elements the rows aren't spread over threads
+#define BROADCAST_MIN_PARALLEL 4096
+
+// The operands of y = a op b laid out over the collapsed axes of y, the last axis is the inner loop.
+// The operands are indexed 0 for y, 1 for a and 2 for b, and step 0 along the axes they're repeated
+typedef struct {
+    int num_dims;
+    int shape[SCYTE_MAX_DIMS];
+    int strides[3][SCYTE_MAX_DIMS];
+} broadcast_layout;
+
+// the size of x along axis d of a shape with num_dims axes, to which x is right-aligned
+static inline int aligned_dim(const scyte_node* x, int num_dims, int d)
+{
+    int k = d - (num_dims - (int)x->num_dims);
+    return k < 0 ? 1 : x->shape[k];
+}
+
+int scyte_broadcast_shape(const scyte_node* a, const scyte_node* b, unsigned* num_dims, int* shape)
+{
+    int n = a->num_dims > b->num_dims ? a->num_dims : b->num_dims;
+    for(int d = 0; d < n; ++d) {
+        int da = aligned_dim(a, n, d), db = aligned_dim(b, n, d);
+        if(da != db && da != 1 && db != 1) return 0;
+        shape[d] = da == 1 ? db : da;
+    }
+    *num_dims = n;
+    return 1;
+}
+
+static inline int is_numpy_broadcast(const scyte_node* node)
+{
+    unsigned num_dims;
+    int shape[SCYTE_MAX_DIMS];
+    return scyte_broadcast_shape(node->children[0], node->children[1], &num_dims, shape);
+}
+
+int scyte_broadcast_sync_dims(scyte_node* node)
+{
+    scyte_node* a = node->children[0], *b = node->children[1];
+    unsigned num_dims;
+    int shape[SCYTE_MAX_DIMS];
+    // the output takes the layout of the first operand
+    scyte_copy_shape(a, node);
+    if(scyte_broadcast_shape(a, b, &num_dims, shape)) {
+        node->num_dims = num_dims;
+        memcpy(node->shape, shape, num_dims*sizeof(int));
+        return 1;
+    }
+    int n0 = scyte_num_elements(a), n1 = scyte_num_elements(b);
+    if(n1 == 0 || n0 % n1 != 0) {
+        LOG_ERRORF("can't broadcast %d elements over %d, the shapes aren't compatible either", n1, n0);
+        return 0;
+    }
+    return 1;
+}
+
+int scyte_broadcast_repeats(const scyte_node* node)
+{
+    if(!is_numpy_broadcast(node)) return 1;
+    int num_dims = node->num_dims;
+    for(int i = 0; i < 2; ++i) {
+        // past the leading axes it's repeated along, a child must match the output
+        int d = 0;
+        while(d < num_dims && aligned_dim(node->children[i], num_dims, d) == 1) ++d;
+        for(; d < num_dims; ++d) {
+            if(aligned_dim(node->children[i], num_dims, d) != node->shape[d]) return 0;
+        }
+    }
+    return 1;
+}
+
+int scyte_broadcast_reads_strided(const scyte_node* node)
+{
+    return is_numpy_broadcast(node);
+}
+
+static void make_layout(const scyte_node* node, broadcast_layout* l)
+{
+    const scyte_node* operands[3] = { node, node->children[0], node->children[1] };
+    int num_dims = node->num_dims;
+    if(!is_numpy_broadcast(node)) {
+        // b is repeated over the rows of the contiguous a and y
+        int n = scyte_num_elements((scyte_node*)operands[2]);
+        l->num_dims = 2;
+        l->shape[0] = scyte_num_elements((scyte_node*)node) / n, l->shape[1] = n;
+        for(int k = 0; k < 3; ++k) l->strides[k][0] = k == 2 ? 0 : n, l->strides[k][1] = 1;
+        return;
+    }
+    int strides[3][SCYTE_MAX_DIMS];
+    for(int k = 0; k < 3; ++k) scyte_get_strides(operands[k], strides[k]);
+    l->num_dims = 0;
+    for(int d = 0; d < num_dims; ++d) {
+        if(node->shape[d] == 1) continue;
+        int s[3], last = l->num_dims - 1, merge = last >= 0;
+        for(int k = 0; k < 3; ++k) {
+            int j = d - (num_dims - (int)operands[k]->num_dims);
+            s[k] = j < 0 || operands[k]->shape[j] == 1 ? 0 : strides[k][j];
+            // an axis is merged into the previous one if every operand steps over both as over one
+            if(merge && l->strides[k][last] != s[k]*node->shape[d]) merge = 0;
+        }
+        if(merge) l->shape[last] *= node->shape[d];
+        else l->shape[++last] = node->shape[d], l->num_dims++;
+        for(int k = 0; k < 3; ++k) l->strides[k][last] = s[k];
+    }
+    if(l->num_dims == 0) {
+        l->num_dims = 1, l->shape[0] = 1;
+        for(int k = 0; k < 3; ++k) l->strides[k][0] = 0;
+    }
+}
+
+// adds the offsets of the operands at index idx of the given axes, the last of them the fastest
+static inline void add_offsets(const broadcast_layout* l, int num_axes, const int* axes, long idx, long offsets[3])
+{
+    for(int j = num_axes - 1; j >= 0; --j) {
+        int d = axes[j];
+        long i = idx % l->shape[d];
+        idx /= l->shape[d];
+        for(int k = 0; k < 3; ++k) offsets[k] += i*l->strides[k][d];
+    }
+}
+
+// y = a op b over a row, y is contiguous
+static void forward_row(scyte_op_type op, int n, const float* a, int sa, const float* b, int sb, float* y)
+{
+    if(sa == 1 && sb == 1) {
+        if(op == ADD) add_cpu(n, a, b, y);
+        else if(op == SUB) sub_cpu(n, a, b, y);
+        else mul_cpu(n, a, b, y);
+    }
+    else if(sa == 1 && sb == 0) {
+        if(op == MULTIPLY) scale_cpu(n, *b, a, y);
+        else bias_cpu(n, op == ADD ? *b : -*b, a, y);
+    }
+    else if(sa == 0 && sb == 1) {
+        if(op == MULTIPLY) scale_cpu(n, *a, b, y);
+        else if(op == ADD) bias_cpu(n, *a, b, y);
+        else {
+            scale_cpu(n, -1.f, b, y);
+            bias_cpu(n, *a, y, y);
+        }
+    }
+    else {
+        for(int i = 0; i < n; ++i) {
+            float x0 = a[(long)i*sa], x1 = b[(long)i*sb];
+            y[i] = op == ADD ? x0 + x1 : op == SUB ? x0 - x1 : x0*x1;
+        }
+    }
+}
+
+void scyte_broadcast_forward(scyte_node* node)
+{
+    broadcast_layout l;
+    make_layout(node, &l);
+    int last = l.num_dims - 1, n = l.shape[last], outer[SCYTE_MAX_DIMS];
+    for(int d = 0; d < last; ++d) outer[d] = d;
+    long size = scyte_num_elements(node), num_rows = size / n;
+    const float* a = node->children[0]->vals, *b = node->children[1]->vals;
+    #pragma omp parallel for if(size >= BROADCAST_MIN_PARALLEL)
+    for(long r = 0; r < num_rows; ++r) {
+        long offsets[3] = { 0 };
+        add_offsets(&l, last, outer, r, offsets);
+        forward_row(node->op_type, n, a + offsets[1], l.strides[1][last], b + offsets[2], l.strides[2][last], node->vals + offsets[0]);
+    }
+}
+
+// gx += sign*g, or g*other for a multiply, over a row, or summed into gx[0] if gx steps 0. g is contiguous
+static void backward_row(scyte_op_type op, float sign, int n, const float* g, const float* other, int so, float* gx, int sx)
+{
+    if(sx == 0) {
+        float sum = 0.f;
+        if(op == MULTIPLY) for(int i = 0; i < n; ++i) sum += g[i]*other[(long)i*so];
+        else for(int i = 0; i < n; ++i) sum += g[i];
+        gx[0] += sign*sum;
+    }
+    else if(sx == 1 && (op != MULTIPLY || so == 0)) axpy_cpu(n, op == MULTIPLY ? *other : sign, g, gx);
+    else if(sx == 1 && so == 1) mul_sum_cpu(n, g, other, gx);
+    else if(op == MULTIPLY) {
+        for(int i = 0; i < n; ++i) gx[(long)i*sx] += g[i]*other[(long)i*so];
+    }
+    else {
+        for(int i = 0; i < n; ++i) gx[(long)i*sx] += sign*g[i];
+    }
+}
+
+void scyte_broadcast_backward(scyte_node* node, int i)
+{
+    broadcast_layout l;
+    make_layout(node, &l);
+    // the outer axes x is repeated along are reduced, the rows it doesn't share are spread over
+    // threads and every thread sums the rows of its own in order
+    int x = i + 1, o = 2 - i, last = l.num_dims - 1, n = l.shape[last];
+    int kept[SCYTE_MAX_DIMS], reduced[SCYTE_MAX_DIMS], num_kept = 0, num_reduced = 0;
+    long num_kept_rows = 1, num_reduced_rows = 1;
+    for(int d = 0; d < last; ++d) {
+        if(l.strides[x][d] != 0) kept[num_kept++] = d, num_kept_rows *= l.shape[d];
+        else reduced[num_reduced++] = d, num_reduced_rows *= l.shape[d];
+    }
+    float sign = node->op_type == SUB && i == 1 ? -1.f : 1.f;
+    const float* other = node->op_type == MULTIPLY ? node->children[1 - i]->vals : NULL;
+    float* gx = node->children[i]->delta;
+    #pragma omp parallel for if(num_kept_rows > 1 && scyte_num_elements(node) >= BROADCAST_MIN_PARALLEL)
+    for(long r = 0; r < num_kept_rows; ++r) {
+        long row[3] = { 0 };
+        add_offsets(&l, num_kept, kept, r, row);
+        for(long s = 0; s < num_reduced_rows; ++s) {
+            long offsets[3] = { row[0], row[1], row[2] };
+            add_offsets(&l, num_reduced, reduced, s, offsets);
+            backward_row(node->op_type, sign, n, node->delta + offsets[0], other ? other + offsets[o] : NULL,
+                    l.strides[o][last], gx + offsets[x], l.strides[x][last]);
+        }
+    }
+}
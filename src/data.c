@@ -19,25 +19,145 @@
 #include <string.h>
 #include <assert.h>
 
-static inline matrix make_matrix(int rows, int cols)
+// rows are padded to whole cache lines, so every row starts 64-byte aligned
+#define MATRIX_ALIGN 16
+
+matrix scyte_make_matrix(int rows, int cols)
 {
     matrix m;
     m.rows = rows, m.cols = cols;
-    m.data = calloc(rows, sizeof(float*));
-    for(int i = 0; i < m.rows; ++i){
-        m.data[i] = calloc(m.cols, sizeof(float));
-    }
+    m.stride = (cols + MATRIX_ALIGN - 1) / MATRIX_ALIGN * MATRIX_ALIGN;
+    size_t size = (size_t)rows*m.stride*sizeof(float);
+    m.slab = (float*)aligned_alloc(64, size > 0 ? size : 64);
+    memset(m.slab, 0, size);
+    m.data = (float**)calloc(rows, sizeof(float*));
+    for(int i = 0; i < m.rows; ++i) m.data[i] = m.slab + (size_t)i*m.stride;
     return m;
 }
 
+void scyte_free_matrix(matrix* m)
+{
+    if(m->slab) free(m->slab);
+    else for(int i = 0; i < m->rows; ++i) free(m->data[i]);
+    free(m->data);
+    m->data = NULL, m->slab = NULL;
+}
+
+void scyte_gather_rows(const matrix* m, int n, const int* indices, float* out)
+{
+    int cols = m->cols;
+    for(int i = 0; i < n; ++i) {
+        // prefetch a few rows ahead, since the indices are usually random
+        if(i + 4 < n) __builtin_prefetch(m->data[indices[i+4]]);
+        memcpy(&out[(size_t)i*cols], m->data[indices[i]], cols*sizeof(float));
+    }
+}
+
 void scyte_random_batch(scyte_data d, int batch_size, float* X, float* y)
 {
-    int x_cols = d.X.cols, y_cols = d.y.cols;
-    for(int i = 0; i < batch_size; ++i) {
-        int idx = rand() % d.X.rows;
-        memcpy(&X[i*x_cols], d.X.data[idx], x_cols*sizeof(float));
-        memcpy(&y[i*y_cols], d.y.data[idx], y_cols*sizeof(float));
+    int* indices = (int*)malloc(batch_size*sizeof(int));
+    scyte_rng* rng = scyte_thread_rng();
+    for(int i = 0; i < batch_size; ++i) indices[i] = scyte_rng_bounded(rng, d.X.rows);
+    scyte_gather_rows(&d.X, batch_size, indices, X);
+    scyte_gather_rows(&d.y, batch_size, indices, y);
+    free(indices);
+}
+
+// assembles the next batch of the sampler's epoch, returns the number of samples in it
+static int assemble_batch(scyte_batch_loader* loader, float* X, float* y)
+{
+    scyte_data d = loader->d;
+    // a finished epoch is followed by a whole new one
+    int epoch_size = scyte_sampler_epoch_size(loader->sampler);
+    int remaining = loader->sampler->pos < epoch_size ? epoch_size - loader->sampler->pos : epoch_size;
+    int batch_size = remaining < loader->batch_size ? remaining : loader->batch_size;
+    for(int i = 0; i < batch_size; ++i) loader->indices[i] = scyte_sampler_next(loader->sampler);
+    scyte_gather_rows(&d.X, batch_size, loader->indices, X);
+    scyte_gather_rows(&d.y, batch_size, loader->indices, y);
+    if(loader->augment) loader->augment(batch_size, X, y, d.X.cols, d.y.cols);
+    return batch_size;
+}
+
+static void* prefetch_batches(void* args)
+{
+    scyte_batch_loader* loader = (scyte_batch_loader*)args;
+    pthread_mutex_lock(&loader->lock);
+    for(;;) {
+        // one buffer is always left for the batch in use
+        while(!loader->stop && loader->count + (loader->in_use >= 0) >= loader->depth) {
+            pthread_cond_wait(&loader->freed, &loader->lock);
+        }
+        if(loader->stop) break;
+        int idx = (loader->head + loader->count) % loader->depth;
+        pthread_mutex_unlock(&loader->lock);
+        loader->sizes[idx] = assemble_batch(loader, loader->X[idx], loader->y[idx]);
+        pthread_mutex_lock(&loader->lock);
+        loader->count++;
+        pthread_cond_signal(&loader->ready);
     }
+    pthread_mutex_unlock(&loader->lock);
+    return NULL;
+}
+
+scyte_batch_loader* scyte_make_batch_loader(scyte_data d, scyte_sampler* sampler, int batch_size, int depth, scyte_augment_fn augment)
+{
+    if(depth < 2) {
+        LOG_ERRORF("couldn't make batch loader, depth must be at least 2 (got %d)", depth);
+        return NULL;
+    }
+    scyte_batch_loader* loader = (scyte_batch_loader*)calloc(1, sizeof(scyte_batch_loader));
+    loader->d = d, loader->sampler = sampler, loader->augment = augment;
+    loader->batch_size = batch_size, loader->depth = depth;
+    loader->X = (float**)calloc(depth, sizeof(float*));
+    loader->y = (float**)calloc(depth, sizeof(float*));
+    loader->sizes = (int*)calloc(depth, sizeof(int));
+    loader->indices = (int*)calloc(batch_size, sizeof(int));
+    for(int i = 0; i < depth; ++i) {
+        loader->X[i] = (float*)malloc(batch_size*d.X.cols*sizeof(float));
+        loader->y[i] = (float*)malloc(batch_size*d.y.cols*sizeof(float));
+    }
+    loader->in_use = -1;
+    pthread_mutex_init(&loader->lock, NULL);
+    pthread_cond_init(&loader->ready, NULL);
+    pthread_cond_init(&loader->freed, NULL);
+    int error = pthread_create(&loader->thread, 0, prefetch_batches, loader);
+    if(error) {
+        LOG_ERRORF("failed to create thread, error code: %d", error);
+        assert(0);
+    }
+    return loader;
+}
+
+void scyte_free_batch_loader(scyte_batch_loader* loader)
+{
+    if(!loader) return;
+    pthread_mutex_lock(&loader->lock);
+    loader->stop = 1;
+    pthread_cond_signal(&loader->freed);
+    pthread_mutex_unlock(&loader->lock);
+    pthread_join(loader->thread, 0);
+    pthread_mutex_destroy(&loader->lock);
+    pthread_cond_destroy(&loader->ready);
+    pthread_cond_destroy(&loader->freed);
+    for(int i = 0; i < loader->depth; ++i) free(loader->X[i]), free(loader->y[i]);
+    free(loader->X); free(loader->y); free(loader->sizes); free(loader->indices);
+    free(loader);
+}
+
+int scyte_next_batch(scyte_batch_loader* loader, float** X, float** y)
+{
+    pthread_mutex_lock(&loader->lock);
+    if(loader->in_use >= 0) {
+        loader->in_use = -1;
+        pthread_cond_signal(&loader->freed);
+    }
+    while(loader->count == 0) pthread_cond_wait(&loader->ready, &loader->lock);
+    loader->in_use = loader->head;
+    loader->head = (loader->head + 1) % loader->depth;
+    loader->count--;
+    pthread_mutex_unlock(&loader->lock);
+    *X = loader->X[loader->in_use], *y = loader->y[loader->in_use];
+    return loader->sizes[loader->in_use];
 }
 
 void* load_classification_data(void* args)
@@ -47,7 +167,11 @@ void* load_classification_data(void* args)
     for(int i = start_idx; i < end_idx; ++i) {
         char* image_path = largs->paths[i];
         image img = load_image(image_path, largs->num_channels);
-        largs->d->X.data[i] = img.data, largs->d->X.cols = img.w*img.h*img.c;
+        if(img.w*img.h*img.c != largs->d->X.cols) {
+            LOG_ERRORF("image %s has %d values instead of %d, leaving it blank", image_path, img.w*img.h*img.c, largs->d->X.cols);
+        }
+        else memcpy(largs->d->X.data[i], img.data, largs->d->X.cols*sizeof(float));
+        free_image(&img);
         for(int j = 0; j < largs->d->y.cols; ++j) {
             if(strstr(image_path, largs->labels[j])) {
                 largs->d->y.data[i][j] = 1;
@@ -63,13 +187,16 @@ scyte_data load_image_classification_data(const char* images, const char* label_
     list* image_list = read_lines(images), *label_list = read_lines(label_file);
     char** labels = (char**)list_to_array(label_list), **paths = (char**)list_to_array(image_list);
     int n = image_list->size, num_labels = label_list->size;
-    matrix X = make_matrix(n, 1), y = make_matrix(n, num_labels);
+    // all images are assumed to have the size of the first, so the data fits one slab
+    image first = load_image(paths[0], num_channels);
+    matrix X = scyte_make_matrix(n, first.w*first.h*first.c), y = scyte_make_matrix(n, num_labels);
     scyte_data d = { X, y };
+    free_image(&first);
 
     pthread_t* threads = calloc(NUM_THREADS, sizeof(pthread_t));
     load_args* args = calloc(NUM_THREADS, sizeof(load_args));
     for(int i = 0; i < NUM_THREADS; ++i) {
-        args[i].d = &d, args->num_channels = num_channels, args[i].paths = paths, args[i].labels = labels;
+        args[i].d = &d, args[i].num_channels = num_channels, args[i].paths = paths, args[i].labels = labels;
         args[i].start_idx = i*n/NUM_THREADS, args[i].end_idx = (i+1)*n/NUM_THREADS;
         int error = pthread_create(&threads[i], 0, load_classification_data, &args[i]);
         if(error) {
@@ -85,9 +212,8 @@ scyte_data load_image_classification_data(const char* images, const char* label_
 
 void scyte_free_data(scyte_data* d)
 {
-    for(int i = 0; i < d->X.rows; ++i) free(d->X.data[i]);
-    for(int i = 0; i < d->y.rows; ++i) free(d->y.data[i]);
-    free(d->X.data), free(d->y.data);
+    scyte_free_matrix(&d->X);
+    scyte_free_matrix(&d->y);
 }
 
 void scyte_print_data(scyte_data d)
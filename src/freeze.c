@@ -0,0 +1,177 @@
+#include "freeze.h"
+
+#include "broadcast.h"
+#include "fusion.h"
+#include "logger.h"
+#include "op.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void free_node(scyte_node* node, int owns_vals)
+{
+    if(owns_vals) free(node->vals);
+    free(node->delta), free(node->tmp);
+    free(node->params), free(node->children);
+    free(node);
+}
+
+// sorts the nodes the root depends on, and frees the other nodes of the old graph
+static scyte_node** prune_graph(int* n, int num_nodes, scyte_node** nodes, scyte_node* root)
+{
+    int num_kept;
+    scyte_node** graph = scyte_make_graph(&num_kept, 1, &root);
+    for(int i = 0; i < num_kept; ++i) graph[i]->mark = 1;
+    // whether a select is a view depends on its children, which are freed before it
+    char* owns_vals = (char*)calloc(num_nodes, 1);
+    for(int i = 0; i < num_nodes; ++i) owns_vals[i] = !scyte_is_placeholder(nodes[i]) && !scyte_is_view(nodes[i]);
+    for(int i = 0; i < num_nodes; ++i) {
+        if(!nodes[i]->mark) free_node(nodes[i], owns_vals[i]);
+    }
+    free(owns_vals);
+    for(int i = 0; i < num_kept; ++i) graph[i]->mark = 0;
+    free(nodes);
+    *n = num_kept;
+    return graph;
+}
+
+// the branch a select takes at inference, the first one of the dynamic selects
+static scyte_node* skip_selects(scyte_node* node)
+{
+    while(!scyte_is_operand(node) && node->op_type == SELECT) {
+        int idx = node->num_children == 2 ? 0 : *(int*)node->params;
+        node = node->children[idx < 0 ? idx + node->num_children : idx];
+    }
+    return node;
+}
+
+static void make_const(scyte_node* node)
+{
+    free(node->children), free(node->params), free(node->tmp), free(node->delta);
+    node->children = NULL, node->params = node->tmp = NULL, node->delta = NULL;
+    node->num_children = 0, node->params_size = 0;
+    memset(node->strides, 0, sizeof(node->strides));
+    node->type = CONST | (node->type & OUTPUT);
+}
+
+// evaluates the op-nodes whose children are all constants, except the random ones
+static void fold_constants(int n, scyte_node** nodes)
+{
+    for(int i = 0; i < n; ++i) {
+        scyte_node* node = nodes[i];
+        if(scyte_is_operand(node) || node->op_type == DROPOUT) continue;
+        int j = 0;
+        while(j < node->num_children && scyte_is_const(node->children[j])) ++j;
+        if(j < node->num_children) continue;
+        node->forward(node);
+        if(scyte_is_view(node)) {
+            // the constant gets contiguous values of its own, its children may be dropped
+            int size = scyte_num_elements(node), strides[SCYTE_MAX_DIMS];
+            float* vals = (float*)malloc(size*sizeof(float));
+            scyte_get_strides(node, strides);
+            if(scyte_is_contiguous(node)) memcpy(vals, node->vals, size*sizeof(float));
+            else scyte_gather_strided(node, strides, node->vals, 0, size, vals);
+            node->vals = vals;
+        }
+        make_const(node);
+    }
+}
+
+// matches y = x*alpha + beta with constant alpha and beta, as built by scyte_layer_layernorm,
+// either as an add of a multiply or fused into a single op
+static int match_affine(scyte_node* y, scyte_node** x, scyte_node** alpha, scyte_node** beta)
+{
+    if(y->op_type == ADD && !scyte_is_operand(y)) {
+        scyte_node* mul = y->children[0];
+        if(scyte_is_operand(mul) || mul->op_type != MULTIPLY) return 0;
+        if(!scyte_broadcast_repeats(y) || !scyte_broadcast_repeats(mul)) return 0;
+        *x = mul->children[0], *alpha = mul->children[1], *beta = y->children[1];
+    }
+    else if(y->op_type == FUSED_ELEMENTWISE && !scyte_is_operand(y) && y->num_children == 3) {
+        static const int affine[] = { MULTIPLY, 0, 1, ADD, 3, 2 };
+        int num_instrs;
+        const int* program = scyte_fused_elementwise_program(y, &num_instrs);
+        if(num_instrs != 2 || memcmp(program, affine, sizeof(affine)) != 0) return 0;
+        *x = y->children[0], *alpha = y->children[1], *beta = y->children[2];
+    }
+    else return 0;
+    return scyte_is_const(*alpha) && scyte_is_const(*beta) && scyte_num_elements(*x) == scyte_num_elements(y);
+}
+
+// (x*alpha + beta) W^T + b = x (W diag(alpha))^T + (b + W beta), W and b are rewritten in place
+// as long as nothing else reads them
+static void fold_affine(int n, scyte_node** nodes)
+{
+    // the marks count the consumers of every node
+    for(int i = 0; i < n; ++i) {
+        for(int j = 0; j < nodes[i]->num_children; ++j) nodes[i]->children[j]->mark++;
+    }
+    for(int i = 0; i < n; ++i) {
+        scyte_node* node = nodes[i], *x, *alpha, *beta;
+        if(scyte_is_operand(node) || node->op_type != CMATMUL) continue;
+        scyte_node* w = node->children[1], *bias = node->num_children > 2 ? node->children[2] : NULL;
+        if(!match_affine(node->children[0], &x, &alpha, &beta)) continue;
+        if(!scyte_is_const(w) || w->mark != 1) continue;
+        if(bias && (!scyte_is_const(bias) || bias->mark != 1)) continue;
+        int rows = node->shape[1], cols = scyte_num_elements(w) / rows;
+        if(scyte_num_elements(alpha) != cols || scyte_num_elements(beta) != cols) continue;
+
+        if(!bias) {
+            bias = scyte_bias(rows, 0.f);
+            bias->type = CONST;
+            scyte_set_cmatmul_epilogue(node, bias, scyte_get_cmatmul_activation(node));
+        }
+        for(int r = 0; r < rows; ++r) {
+            float* w_row = w->vals + r*cols;
+            for(int c = 0; c < cols; ++c) {
+                bias->vals[r] += w_row[c]*beta->vals[c];
+                w_row[c] *= alpha->vals[c];
+            }
+        }
+        node->children[0] = x;
+    }
+    for(int i = 0; i < n; ++i) nodes[i]->mark = 0;
+}
+
+scyte_node** scyte_freeze_graph(int* n, int num_nodes, scyte_node** nodes)
+{
+    int out = -1;
+    for(int i = 0; i < num_nodes; ++i) {
+        if(!(nodes[i]->type & OUTPUT)) continue;
+        if(out >= 0) {
+            LOG_ERROR("couldn't freeze graph, it has more than one output node");
+            return NULL;
+        }
+        out = i;
+    }
+    if(out < 0) {
+        LOG_ERROR("couldn't freeze graph, it has no output node");
+        return NULL;
+    }
+
+    scyte_node** graph = scyte_copy_graph(num_nodes, nodes, 1);
+    for(int i = 0; i < num_nodes; ++i) {
+        scyte_node* node = graph[i];
+        if(scyte_is_var(node) || scyte_is_const(node)) {
+            int size = scyte_num_elements(node);
+            node->vals = (float*)malloc(size*sizeof(float));
+            memcpy(node->vals, nodes[i]->vals, size*sizeof(float));
+            node->type = (node->type & ~VAR) | CONST;
+        }
+        else if(!scyte_is_operand(node)) {
+            free(node->delta);
+            node->delta = NULL, node->type &= ~VAR;
+        }
+        for(int j = 0; j < node->num_children; ++j) node->children[j] = skip_selects(node->children[j]);
+    }
+    scyte_node* root = skip_selects(graph[out]);
+    root->type |= OUTPUT;
+
+    graph = prune_graph(&num_nodes, num_nodes, graph, root);
+    fold_constants(num_nodes, graph);
+    fold_affine(num_nodes, graph);
+    // drops the constants that were folded into others
+    graph = prune_graph(&num_nodes, num_nodes, graph, root);
+    *n = scyte_fuse_graph(num_nodes, graph);
+    return graph;
+}
@@ -0,0 +1,229 @@
+#include "fusion.h"
+
+#include "blas.h"
+#include "broadcast.h"
+#include "op.h"
+
+#include <stdlib.h>
+#include <math.h>
+
+static int fusion_enabled = 1;
+
+void scyte_set_graph_fusion(int enabled)
+{
+    fusion_enabled = enabled;
+}
+
+void scyte_activate(int n, scyte_activation act, float* y)
+{
+    switch(act) {
+        case SCYTE_ACTIVATION_RELU: for(int i = 0; i < n; ++i) y[i] = y[i]*(y[i] > 0.f); break;
+        case SCYTE_ACTIVATION_SIGMOID: sigmoid_cpu(n, y, y); break;
+        case SCYTE_ACTIVATION_TANH: tanh_cpu(n, y, y); break;
+        case SCYTE_ACTIVATION_NONE: break;
+    }
+}
+
+void scyte_activation_gradient(int n, scyte_activation act, const float* y, float* delta)
+{
+    switch(act) {
+        case SCYTE_ACTIVATION_RELU: for(int i = 0; i < n; ++i) delta[i] *= (y[i] > 0.f); break;
+        case SCYTE_ACTIVATION_SIGMOID: for(int i = 0; i < n; ++i) delta[i] *= y[i]*(1.f - y[i]); break;
+        case SCYTE_ACTIVATION_TANH: for(int i = 0; i < n; ++i) delta[i] *= 1.f - y[i]*y[i]; break;
+        case SCYTE_ACTIVATION_NONE: break;
+    }
+}
+
+static scyte_activation get_activation(scyte_op_type op_type)
+{
+    if(op_type == RELU) return SCYTE_ACTIVATION_RELU;
+    if(op_type == SIGMOID) return SCYTE_ACTIVATION_SIGMOID;
+    if(op_type == TANH) return SCYTE_ACTIVATION_TANH;
+    return SCYTE_ACTIVATION_NONE;
+}
+
+static int is_fusible_elementwise(const scyte_node* node)
+{
+    switch(node->op_type) {
+        case ADD: case SUB: case MULTIPLY:
+            // fused ops repeat smaller inputs as flat arrays, which is no numpy broadcast along inner axes
+            return !scyte_is_operand(node) && scyte_broadcast_repeats(node);
+        case SQUARE: case EXP: case SIGMOID: case TANH: case RELU:
+            return !scyte_is_operand(node);
+        default:
+            return 0;
+    }
+}
+
+typedef struct {
+    int n;
+    scyte_node** nodes;
+    int* num_consumers;
+    int* consumer;  // the last consumer of every node
+    int* removed;
+} fusion_graph;
+
+static void count_consumers(fusion_graph* g)
+{
+    for(int i = 0; i < g->n; ++i) {
+        if(!g->removed[i]) g->nodes[i]->mark = i;
+        g->num_consumers[i] = 0, g->consumer[i] = -1;
+    }
+    for(int i = 0; i < g->n; ++i) {
+        if(g->removed[i]) continue;
+        for(int j = 0; j < g->nodes[i]->num_children; ++j) {
+            int child = g->nodes[i]->children[j]->mark;
+            g->num_consumers[child]++, g->consumer[child] = i;
+        }
+    }
+}
+
+// the consumer node can be fused into, if it's the only one and node isn't read from outside the graph
+static scyte_node* single_consumer(const fusion_graph* g, const scyte_node* node)
+{
+    int i = node->mark;
+    if(scyte_is_operand(node) || g->num_consumers[i] != 1 || (node->type & (OUTPUT | COST))) return NULL;
+    return g->nodes[g->consumer[i]];
+}
+
+static void remove_node(fusion_graph* g, scyte_node* node)
+{
+    g->removed[node->mark] = 1;
+    free(node->vals), free(node->delta), free(node->tmp);
+    free_op_node(node);
+}
+
+// Moves the op of src into node, which keeps its place in the graph, its type and its consumers.
+// src is freed, its children now belong to node
+static void move_op(scyte_node* node, scyte_node* src)
+{
+    free(node->children), free(node->params), free(node->tmp);
+    node->op_type = src->op_type;
+    node->forward = src->forward, node->backward = src->backward;
+    node->num_children = src->num_children, node->children = src->children;
+    node->params = src->params, node->params_size = src->params_size;
+    node->tmp = src->tmp;
+    scyte_copy_shape(src, node);
+    free(src->vals), free(src->delta);
+    free(src);
+}
+
+// cmatmul -> add bias -> activation and conv -> activation
+static void fuse_epilogues(fusion_graph* g)
+{
+    for(int i = 0; i < g->n; ++i) {
+        scyte_node* node = g->nodes[i];
+        if(g->removed[i] || (node->op_type != CMATMUL && node->op_type != CONV2D)) continue;
+        if(node->op_type == CMATMUL && node->num_children != 2) continue;
+        if(node->op_type == CONV2D && scyte_get_conv_activation(node) != SCYTE_ACTIVATION_NONE) continue;
+        scyte_node* root = node, *add = NULL, *consumer = single_consumer(g, node);
+        if(node->op_type == CMATMUL && consumer && consumer->op_type == ADD && consumer->children[0] == node
+                && consumer->children[1] != node && scyte_num_elements(consumer->children[1]) == node->shape[1]
+                && scyte_broadcast_repeats(consumer)) {
+            add = root = consumer;
+            consumer = single_consumer(g, root);
+        }
+        scyte_activation act = consumer ? get_activation(consumer->op_type) : SCYTE_ACTIVATION_NONE;
+        if(act != SCYTE_ACTIVATION_NONE) root = consumer;
+        if(root == node) continue;
+
+        if(node->op_type == CMATMUL) scyte_set_cmatmul_epilogue(node, add ? add->children[1] : NULL, act);
+        else scyte_set_conv_activation(node, act);
+        if(add && add != root) remove_node(g, add);
+        g->removed[i] = 1;
+        move_op(root, node);
+    }
+}
+
+typedef struct {
+    int num_inputs, num_instrs;
+    scyte_node* inputs[SCYTE_FUSED_MAX_REGS];
+    int program[3*SCYTE_FUSED_MAX_REGS];
+} fused_group;
+
+// emits the instructions of node after those of its fused children, returns the register of its
+// result. While building, the inputs are the registers -1, -2, ...
+static int emit_group(fused_group* f, scyte_node* node, const int* in_group)
+{
+    int operands[2];
+    for(int j = 0; j < node->num_children; ++j) {
+        scyte_node* child = node->children[j];
+        if(in_group[child->mark]) {
+            operands[j] = emit_group(f, child, in_group);
+            continue;
+        }
+        int k = 0;
+        while(k < f->num_inputs && f->inputs[k] != child) ++k;
+        if(k == f->num_inputs) f->inputs[f->num_inputs++] = child;
+        operands[j] = -(k + 1);
+    }
+    int* instr = &f->program[3*f->num_instrs];
+    instr[0] = node->op_type, instr[1] = operands[0], instr[2] = node->num_children > 1 ? operands[1] : operands[0];
+    return f->num_instrs++;
+}
+
+// every fusible node that isn't fused into its consumer is the root of a group, which takes in the
+// fusible nodes below it that nothing else consumes, for as long as its registers suffice
+static void fuse_elementwise(fusion_graph* g)
+{
+    int* in_group = (int*)calloc(g->n, sizeof(int));
+    scyte_node** members = (scyte_node**)malloc(SCYTE_FUSED_MAX_REGS*sizeof(scyte_node*));
+    for(int i = g->n - 1; i >= 0; --i) {
+        scyte_node* root = g->nodes[i];
+        if(g->removed[i] || in_group[i] || !is_fusible_elementwise(root)) continue;
+        // the inputs are at most the children of the members that aren't members themselves
+        int num_members = 1, num_inputs = root->num_children, size = scyte_num_elements(root);
+        members[0] = root;
+        in_group[i] = 1;
+        for(int m = 0; m < num_members; ++m) {
+            for(int j = 0; j < members[m]->num_children; ++j) {
+                scyte_node* child = members[m]->children[j];
+                if(!is_fusible_elementwise(child) || single_consumer(g, child) != members[m]) continue;
+                if(scyte_num_elements(child) != size || in_group[child->mark]) continue;
+                if(num_members + 1 + num_inputs - 1 + child->num_children > SCYTE_FUSED_MAX_REGS) continue;
+                members[num_members++] = child;
+                in_group[child->mark] = 1;
+                num_inputs += child->num_children - 1;
+            }
+        }
+        if(num_members == 1) continue;
+
+        fused_group f = { 0 };
+        emit_group(&f, root, in_group);
+        // the inputs take the first registers
+        for(int k = 0; k < 3*f.num_instrs; ++k) {
+            if(k % 3 == 0) continue;
+            f.program[k] = f.program[k] < 0 ? -f.program[k] - 1 : f.num_inputs + f.program[k];
+        }
+        scyte_node* fused = scyte_fused_elementwise(f.num_inputs, f.inputs, f.num_instrs, f.program);
+        if(!fused) continue;
+        for(int m = 1; m < num_members; ++m) remove_node(g, members[m]);
+        move_op(root, fused);
+    }
+    free(in_group); free(members);
+}
+
+int scyte_fuse_graph(int n, scyte_node** nodes)
+{
+    if(!fusion_enabled) return n;
+    fusion_graph g = { n, nodes };
+    g.num_consumers = (int*)calloc(n, sizeof(int));
+    g.consumer = (int*)calloc(n, sizeof(int));
+    g.removed = (int*)calloc(n, sizeof(int));
+
+    count_consumers(&g);
+    fuse_epilogues(&g);
+    count_consumers(&g);
+    fuse_elementwise(&g);
+
+    int num_fused = 0;
+    for(int i = 0; i < n; ++i) {
+        if(g.removed[i]) continue;
+        nodes[i]->mark = 0;
+        nodes[num_fused++] = nodes[i];
+    }
+    free(g.num_consumers); free(g.consumer); free(g.removed);
+    // the fused ops read strided inputs, so transposes packed for the ops they replaced may be views again
+    scyte_sync_views(num_fused, nodes);
+    return num_fused;
+}
@@ -56,14 +56,13 @@ scyte_node* scyte_layer_dropout(scyte_node* in, float dropout_rate)
 
 scyte_node* scyte_layer_layernorm(scyte_node* in)
 {
-
-    int dim = in->num_dims >= 2 ?
-            scyte_num_elements(in) / in->shape[0] : scyte_num_elements(in);
     char* shape_str = get_shape_string(in->num_dims, in->shape);
     fprintf(stderr, "layer_norm                          %s\n", shape_str);
 
-    scyte_node* alpha = scyte_bias(dim, 1.f);
-    scyte_node* beta  = scyte_bias(dim, 0.f);
+    // alpha and beta have the shape of a sample, so they broadcast over the batch
+    int num_dims = in->num_dims >= 2 ? in->num_dims - 1 : in->num_dims;
+    scyte_node* alpha = scyte_var(num_dims, in->shape + in->num_dims - num_dims, 1.f);
+    scyte_node* beta  = scyte_var(num_dims, in->shape + in->num_dims - num_dims, 0.f);
 
     free(shape_str);
 
@@ -81,11 +80,11 @@ scyte_node* scyte_layer_cost(scyte_node* in, int num_out, cost_type type)
     switch(type) {
         case COST_BINARY_CROSS_ENTROPY:
             pred = scyte_sigmoid(pred);
-            cost = scyte_logistic_x_entropy(truth, pred);
+            cost = scyte_sigmoid_x_entropy(truth, pred);
             break;
         case COST_CROSS_ENTROPY:
             pred = scyte_softmax(pred);
-            cost = scyte_categorical_x_entropy(truth, pred);
+            cost = scyte_softmax_x_entropy(truth, pred);
             break;
         case COST_L1:
             cost = scyte_l1_norm(truth, pred);
@@ -112,6 +111,23 @@ scyte_node* scyte_layer_maxpool2d(scyte_node* in, int size, int stride, int padd
     return out;
 }
 
+scyte_node* scyte_layer_avgpool2d(scyte_node* in, int size, int stride, int padding)
+{
+    scyte_node* out = scyte_avgpool2d(in, size, stride, padding);
+    int c = in->shape[1], h = in->shape[2], w = in->shape[3];
+    int out_c = out->shape[1], out_h = out->shape[2], out_w = out->shape[3];
+    fprintf(stderr, "avgpool2d                        %d x %d / %d  %4d x%4d x%4d   ->  %4d x%4d x%4d\n", size, size, stride, w, h, c, out_w, out_h, out_c);
+    return out;
+}
+
+scyte_node* scyte_layer_global_avgpool2d(scyte_node* in)
+{
+    scyte_node* out = scyte_global_avgpool2d(in);
+    int c = in->shape[1], h = in->shape[2], w = in->shape[3];
+    fprintf(stderr, "global_avgpool2d                           %4d x%4d x%4d   ->  %4d\n", w, h, c, out->shape[1]);
+    return out;
+}
+
 scyte_node* scyte_layer_conv2d(scyte_node* in, int num_filters, int size, int stride, int padding)
 {
     int c = in->shape[1], h = in->shape[2], w = in->shape[3];
@@ -0,0 +1,160 @@
+#include "layout.h"
+
+#include "op.h"
+
+#include <stdlib.h>
+
+#define NUM_LAYOUTS 4
+
+const char* scyte_layout_string(scyte_layout layout)
+{
+    switch(layout) {
+        case SCYTE_NCHW: return "nchw";
+        case SCYTE_NHWC: return "nhwc";
+        case SCYTE_NCHW8C: return "nchw8c";
+        case SCYTE_NCHW16C: return "nchw16c";
+    }
+    return "unknown";
+}
+
+int scyte_layout_block(scyte_layout layout)
+{
+    if(layout == SCYTE_NCHW8C) return 8;
+    if(layout == SCYTE_NCHW16C) return 16;
+    return layout == SCYTE_NHWC ? 0 : 1;
+}
+
+int scyte_layout_supported(scyte_layout layout, int channels)
+{
+    if(layout < SCYTE_NCHW || layout > SCYTE_NCHW16C) return 0;
+    int block = scyte_layout_block(layout);
+    return block <= 1 || channels % block == 0;
+}
+
+scyte_layout_strides scyte_layout_get_strides(scyte_layout layout, const int shape[4])
+{
+    size_t c = shape[1], h = shape[2], w = shape[3];
+    scyte_layout_strides s = { 1, c*h*w, h*w, w, 1, 0 };
+    int block = scyte_layout_block(layout);
+    if(block == 0) s.block = c, s.channel_block = 0, s.row = w*c, s.col = c, s.channel = 1;
+    else if(block > 1) s.block = block, s.channel_block = h*w*block, s.row = w*block, s.col = block, s.channel = 1;
+    return s;
+}
+
+// every row of a block of channels of dst is contiguous, and filled one channel at a time
+void scyte_layout_copy(const int shape[4], const float* src, scyte_layout src_layout,
+        float* dst, scyte_layout dst_layout, int accumulate)
+{
+    scyte_layout_strides s = scyte_layout_get_strides(src_layout, shape), d = scyte_layout_get_strides(dst_layout, shape);
+    int num_blocks = shape[1] / d.block, height = shape[2], width = shape[3];
+    #pragma omp parallel for
+    for(int i = 0; i < shape[0]*num_blocks*height; ++i) {
+        int n = i / (num_blocks*height), cb = i / height % num_blocks, h = i % height;
+        for(int c = cb*d.block; c < (cb + 1)*d.block; ++c) {
+            const float* in = src + scyte_layout_offset(&s, n, c, h, 0);
+            float* out = dst + scyte_layout_offset(&d, n, c, h, 0);
+            if(accumulate) for(int w = 0; w < width; ++w) out[w*d.col] += in[w*s.col];
+            else for(int w = 0; w < width; ++w) out[w*d.col] = in[w*s.col];
+        }
+    }
+}
+
+// ops that compute each element from the same element of their operands run in any layout.
+// Broadcasting a smaller operand depends on the layout though, so all operands must be as large
+static int is_elementwise(const scyte_node* node)
+{
+    switch(node->op_type) {
+        case RELU: case SIGMOID: case TANH: case EXP: case LOG: case SIN: case SQUARE: case DROPOUT:
+            return 1;
+        case ADD: case SUB: case MULTIPLY: case SELECT: case FUSED_ELEMENTWISE:
+            for(int i = 0; i < node->num_children; ++i) {
+                if(node->children[i]->num_dims != 4 || scyte_num_elements(node->children[i]) != scyte_num_elements((scyte_node*)node)) return 0;
+            }
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// the children of a node that hold its input tensors, as opposed to its weights or parameters
+static int is_tensor_child(const scyte_node* node, int i)
+{
+    if(node->op_type == CONV2D || node->op_type == MAXPOOL2D || node->op_type == DROPOUT) return i == 0;
+    return node->children[i]->num_dims == 4;
+}
+
+static scyte_layout choose_layout(const scyte_node* node, int num_consumers, scyte_layout layout)
+{
+    if(node->num_dims != 4 || num_consumers == 0 || (node->type & (OUTPUT | COST))) return SCYTE_NCHW;
+    if(node->op_type == CONV2D) {
+        int in_c = node->children[0]->shape[1], out_c = node->shape[1];
+        return scyte_layout_supported(layout, in_c) && scyte_layout_supported(layout, out_c) ? layout : SCYTE_NCHW;
+    }
+    // the others follow the layout their inputs are already in
+    if(node->op_type == MAXPOOL2D || node->op_type == AVGPOOL2D || node->op_type == GLOBAL_AVGPOOL2D) return node->children[0]->layout;
+    if(is_elementwise(node)) {
+        for(int i = 0; i < node->num_children; ++i) {
+            if(is_tensor_child(node, i) && node->children[i]->layout != SCYTE_NCHW) return node->children[i]->layout;
+        }
+    }
+    return SCYTE_NCHW;
+}
+
+scyte_node** scyte_convert_layout(int* n, scyte_node** nodes, scyte_layout layout)
+{
+    int num_nodes = *n, num_transforms = 0;
+    // transforms[i*NUM_LAYOUTS + l] transforms nodes[i] into layout l
+    scyte_node** transforms = (scyte_node**)calloc(num_nodes*NUM_LAYOUTS, sizeof(scyte_node*));
+    int* num_consumers = (int*)calloc(num_nodes, sizeof(int)), *orphaned = (int*)calloc(num_nodes, sizeof(int));
+    for(int i = 0; i < num_nodes; ++i) nodes[i]->mark = i;
+    for(int i = 0; i < num_nodes; ++i) {
+        for(int j = 0; j < nodes[i]->num_children; ++j) num_consumers[nodes[i]->children[j]->mark]++;
+    }
+
+    for(int i = 0; i < num_nodes; ++i) {
+        scyte_node* node = nodes[i];
+        if(scyte_is_operand(node) || node->op_type == LAYOUT_TRANSFORM) continue;
+        scyte_layout target = choose_layout(node, num_consumers[i], layout);
+        for(int j = 0; j < node->num_children; ++j) {
+            scyte_node* child = node->children[j];
+            if(!is_tensor_child(node, j)) continue;
+            // transforms inserted by an earlier pass are looked through, rather than chained
+            if(child->op_type == LAYOUT_TRANSFORM && (child->layout != target || child->children[0]->layout == target)) {
+                orphaned[child->mark] = --num_consumers[child->mark] == 0;
+                child = child->children[0];
+            }
+            if(child->layout == target) {
+                node->children[j] = child;
+                continue;
+            }
+            scyte_node** transform = &transforms[child->mark*NUM_LAYOUTS + target];
+            if(!*transform) {
+                *transform = scyte_layout_transform(child, target);
+                ++num_transforms;
+            }
+            node->children[j] = *transform;
+        }
+        scyte_get_resync_function(node->op_type)(node);
+    }
+
+    // every transform is sorted right after the node it transforms, and the transforms no longer
+    // consumed are dropped
+    scyte_node** converted = (scyte_node**)malloc((num_nodes + num_transforms)*sizeof(scyte_node*));
+    int num_converted = 0;
+    for(int i = 0; i < num_nodes; ++i) {
+        scyte_node* node = nodes[i];
+        if(orphaned[i]) {
+            free(node->vals), free(node->delta), free(node->tmp);
+            free_op_node(node);
+            continue;
+        }
+        node->mark = 0;
+        converted[num_converted++] = node;
+        for(int l = 0; l < NUM_LAYOUTS; ++l) {
+            if(transforms[i*NUM_LAYOUTS + l]) converted[num_converted++] = transforms[i*NUM_LAYOUTS + l];
+        }
+    }
+    free(transforms); free(num_consumers); free(orphaned);
+    *n = num_converted;
+    return converted;
+}
@@ -19,6 +19,7 @@ void* list_pop(list* l)
     void* data = n->data;
     l->tail = l->tail->prev;
     if(l->tail) l->tail->next = NULL;
+    else l->head = NULL;
     free(n);
     --l->size;
     
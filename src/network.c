@@ -1,12 +1,39 @@
 #define SCYTE_VERBOSE
 #include "network.h"
 
+#include "freeze.h"
+#include "fusion.h"
+#include "layout.h"
 #include "logger.h"
 #include "utils.h"
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <assert.h>
 #include <float.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// the mappable model format is laid out as: header | graph | weights, where the variables start
+// at a page boundary and the constants at the next 64-byte boundary after the variables
+#define SCYTE_MODEL_MAGIC "SCYTEMAP"
+#define SCYTE_MODEL_VERSION 1
+#define SCYTE_MODEL_PAGE_SIZE 4096
+#define SCYTE_MODEL_ALIGN 64
+// frozen networks have a format of their own, laid out like the mappable one but without variables
+#define SCYTE_FROZEN_MAGIC "SCYTEINF"
+#define SCYTE_FROZEN_VERSION 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t graph_offset;
+    uint64_t vars_offset, num_vars;
+    uint64_t consts_offset, num_consts;
+} scyte_model_header;
 
 // switch between forward and backward propagation mode
 static inline void switch_propagation_mode(scyte_network* net, int is_backward)
@@ -65,9 +92,12 @@ static inline void alloc_network(scyte_network* net)
     int j = 0, k = 0;
     int num_vars = get_num_vars(net), num_consts = get_num_consts(net);
     net->vals = (float*)realloc(net->vals, num_vars*sizeof(float));
-    net->deltas = (float*)realloc(net->deltas, num_vars*sizeof(float));
     net->consts = (float*)realloc(net->consts, num_consts*sizeof(float));
-    memset(net->deltas, 0, num_vars*sizeof(float));
+    // frozen networks have nothing to train
+    if(!net->frozen) {
+        net->deltas = (float*)realloc(net->deltas, num_vars*sizeof(float));
+        memset(net->deltas, 0, num_vars*sizeof(float));
+    }
     for(int i = 0; i < net->n; ++i) {
         scyte_node* node = net->nodes[i];
         int num_elements = scyte_num_elements(node);
@@ -75,7 +105,7 @@ static inline void alloc_network(scyte_network* net)
             memcpy(&net->vals[j], node->vals, num_elements*sizeof(float));
             free(node->vals);
             node->vals = &net->vals[j];
-            node->delta = &net->deltas[j];
+            node->delta = net->deltas ? &net->deltas[j] : NULL;
             j += num_elements;
         }
         else if(scyte_is_const(node)) {
@@ -87,6 +117,94 @@ static inline void alloc_network(scyte_network* net)
     }
 }
 
+// lays out the values and deltas of the op-nodes in an arena according to a memory plan
+static void plan_graph(int n, scyte_node** nodes, float** arena, int mode)
+{
+    if(!*arena) scyte_release_op_buffers(n, nodes);
+    scyte_memory_plan plan = scyte_plan_memory(n, nodes, mode);
+    *arena = (float*)realloc(*arena, plan.size*sizeof(float));
+    scyte_bind_memory(n, nodes, &plan, *arena);
+    scyte_free_memory_plan(&plan);
+}
+
+// compiles the pass to or from the node of the given type on first use, NULL if there's no such node
+static scyte_exec_plan* get_exec(scyte_network* net, scyte_exec_plan** exec, scyte_node_type type, int backward)
+{
+    if(!*exec) {
+        int idx = scyte_find_node(net, type);
+        if(idx < 0) return NULL;
+        *exec = scyte_compile_exec(net->n, net->nodes, idx, backward);
+    }
+    return *exec;
+}
+
+// runs a pass on the network's scheduler, if it has one
+static inline const float* run_exec(scyte_network* net, scyte_exec_plan* exec)
+{
+    return net->scheduler ? scyte_schedule_exec(net->scheduler, exec) : scyte_run_exec(exec);
+}
+
+static void free_execs(scyte_network* net)
+{
+    scyte_free_exec(net->predict_exec); scyte_free_exec(net->cost_exec); scyte_free_exec(net->grad_exec);
+    net->predict_exec = net->cost_exec = net->grad_exec = NULL;
+}
+
+static void plan_network(scyte_network* net, int mode)
+{
+    plan_graph(net->n, net->nodes, &net->arena, net->scheduler ? mode | SCYTE_PLAN_CONCURRENT : mode);
+    net->plan_mode = mode;
+}
+
+int scyte_set_network_layout(scyte_network* net, scyte_layout layout)
+{
+    if(layout < SCYTE_NCHW || layout > SCYTE_NCHW16C) {
+        LOG_ERRORF("unknown layout %d", layout);
+        return 0;
+    }
+    // the op-nodes are planned again with the transforms, so they give up their place in the arena
+    for(int i = 0; i < net->n; ++i) {
+        if(!scyte_is_operand(net->nodes[i])) net->nodes[i]->vals = net->nodes[i]->delta = NULL;
+    }
+    free(net->arena);
+    net->arena = NULL;
+    scyte_node** nodes = scyte_convert_layout(&net->n, net->nodes, layout);
+    free(net->nodes);
+    net->nodes = nodes;
+    free_execs(net);
+    plan_network(net, net->plan_mode);
+    return 1;
+}
+
+void scyte_set_network_threads(scyte_network* net, int num_threads)
+{
+    net->num_threads = num_threads;
+}
+
+void scyte_set_network_inter_op_threads(scyte_network* net, int num_threads)
+{
+    scyte_free_scheduler(net->scheduler);
+    net->scheduler = num_threads > 1 ? scyte_make_scheduler(num_threads) : NULL;
+    // the branches that may run side by side get memory of their own
+    plan_network(net, net->plan_mode);
+}
+
+void scyte_set_network_augment(scyte_network* net, scyte_augment_fn augment)
+{
+    net->augment = augment;
+}
+
+void scyte_set_network_seed(scyte_network* net, uint64_t seed)
+{
+    net->seed = seed;
+}
+
+void scyte_set_network_batch_size(scyte_network* net, int batch_size, int mode)
+{
+    int old_batch_size = scyte_resync_batch_size(net->n, net->nodes, batch_size);
+    if(old_batch_size != batch_size || mode != net->plan_mode) plan_network(net, mode);
+}
+
 scyte_network* scyte_make_network(scyte_node* cost_node)
 {
     return scyte_make_network2(cost_node, 0, NULL);
@@ -104,35 +222,103 @@ scyte_network* scyte_make_network2(scyte_node* cost_node, int num_other_roots, s
     for(i = 0; i < num_other_roots; ++i) roots[i] = other_roots[i];
     roots[i] = cost_node;
     net->nodes = scyte_make_graph(&net->n, num_roots, roots);
+    net->n = scyte_fuse_graph(net->n, net->nodes);
     alloc_network(net);
+    plan_network(net, SCYTE_PLAN_TRAIN);
     free(roots);
     return net;
 }
 
 const float* scyte_predict_network(scyte_network* net, float* data)
 {
-    int out_idx = scyte_find_node(net, OUTPUT);
-    if(out_idx < 0) {
+    scyte_exec_plan* exec = get_exec(net, &net->predict_exec, OUTPUT, 0);
+    if(!exec) {
         LOG_ERROR("couldn't find any output node");
         return NULL;
     }
-    scyte_set_batch_size(net->n, net->nodes, 1);
+    scyte_set_network_batch_size(net, 1, SCYTE_PLAN_PREDICT);
     scyte_feed_net(net, INPUT, &data);
-    return scyte_forward(net->n, net->nodes, out_idx);
+    return run_exec(net, exec);
+}
+
+scyte_network* scyte_freeze_network(const scyte_network* net)
+{
+    scyte_network* frozen = (scyte_network*)calloc(1, sizeof(scyte_network));
+    frozen->nodes = scyte_freeze_graph(&frozen->n, net->n, net->nodes);
+    if(!frozen->nodes) {
+        free(frozen);
+        return NULL;
+    }
+    frozen->frozen = 1;
+    alloc_network(frozen);
+    plan_network(frozen, SCYTE_PLAN_PREDICT);
+    return frozen;
+}
+
+scyte_session* scyte_make_session(const scyte_network* net)
+{
+    scyte_session* session = (scyte_session*)calloc(1, sizeof(scyte_session));
+    session->net = net;
+    session->n = net->n;
+    session->nodes = scyte_copy_graph(net->n, net->nodes, 1);
+    session->out_idx = scyte_find_node(net, OUTPUT);
+    if(session->out_idx >= 0) session->exec = scyte_compile_exec(session->n, session->nodes, session->out_idx, 0);
+    session->batch_size = 1;
+    plan_graph(session->n, session->nodes, &session->arena, SCYTE_PLAN_PREDICT);
+    return session;
+}
+
+void scyte_free_session(scyte_session* session)
+{
+    if(!session) return;
+    for(int i = 0; i < session->n; ++i) {
+        scyte_node* node = session->nodes[i];
+        if(scyte_is_operand(node)) node->vals = NULL; // the weights belong to the network
+        else node->vals = node->delta = NULL;
+    }
+    free(session->arena);
+    scyte_free_exec(session->exec);
+    scyte_free_graph(session->n, session->nodes);
+    free(session);
+}
+
+const float* scyte_session_predict(scyte_session* session, int batch_size, float* data)
+{
+    if(session->out_idx < 0) {
+        LOG_ERROR("couldn't find any output node");
+        return NULL;
+    }
+    if(batch_size != session->batch_size) {
+        scyte_resync_batch_size(session->n, session->nodes, batch_size);
+        plan_graph(session->n, session->nodes, &session->arena, SCYTE_PLAN_PREDICT);
+        session->batch_size = batch_size;
+    }
+    for(int i = 0; i < session->n; ++i) {
+        if(scyte_is_input(session->nodes[i])) scyte_feed_placeholder(session->nodes[i], data);
+    }
+    return scyte_run_exec(session->exec);
 }
 
 static inline float scyte_calculate_cost(scyte_network* net, int calc_grads)
 {
-    int cost_idx = scyte_find_node(net, COST);
-    if(cost_idx < 0) {
+    scyte_exec_plan* forward = get_exec(net, &net->cost_exec, COST, 0);
+    if(!forward) {
         LOG_ERROR("couldn't find any cost node");
         assert(0);
     }
-    float cost = *scyte_forward(net->n, net->nodes, cost_idx);
-    if(calc_grads) scyte_backward(net->n, net->nodes, cost_idx);
+    float cost = *run_exec(net, forward);
+    if(calc_grads) run_exec(net, get_exec(net, &net->grad_exec, COST, 1));
     return cost;
 }
 
+// runs a minibatch through the network itself, or split across its data-parallel replicas
+static inline float run_batch(scyte_network* net, scyte_replicas* replicas, int batch_size, float* X, float* y, int calc_grads)
+{
+    if(replicas) return scyte_run_replicas(replicas, batch_size, X, y, calc_grads);
+    scyte_set_network_batch_size(net, batch_size, SCYTE_PLAN_TRAIN);
+    return scyte_calculate_cost(net, calc_grads);
+}
+
 static inline void optimizer_step(scyte_optimizer_params params, scyte_network* net, int n, float* g_prev, float* g_mean, float* g_var)
 {
     if(params.type == ADAM) scyte_adam_step(params, n, net->deltas, g_var, g_mean, net->vals);
@@ -142,6 +328,14 @@ static inline void optimizer_step(scyte_optimizer_params params, scyte_network*
 
 void scyte_train_network(scyte_network* net, scyte_optimizer_params params, int batch_size, int num_epochs, float val_split, int early_stop_patience, scyte_data data)
 {
+    if(net->mapped) {
+        LOG_ERROR("couldn't train network, its weights are memory mapped read-only");
+        return;
+    }
+    if(net->frozen) {
+        LOG_ERROR("couldn't train network, it's frozen for inference");
+        return;
+    }
     int n = data.X.rows;
     int num_in = get_placeholder_dim(net, INPUT), num_target = get_placeholder_dim(net, GROUND_TRUTH);
     assert(num_in == data.X.cols && num_target == data.y.cols);
@@ -157,12 +351,23 @@ void scyte_train_network(scyte_network* net, scyte_optimizer_params params, int
         if(params.type == ADAM) g_mean = (float*)calloc(num_vars, sizeof(float));
     }
 
-    float* X = (float*)malloc(num_in*batch_size*sizeof(float));
-    float* y = (float*)malloc(num_target*batch_size*sizeof(float));
-    scyte_feed_net(net, INPUT, &X); // input node will be binded to input array
-    scyte_feed_net(net, GROUND_TRUTH, &y); // ground truth node will be binded to target array
-
+    // the data is split once into a training and a validation set, each sampled without replacement.
+    // batches are prefetched while training, and fed by pointing the placeholders at them
     int num_val = n*val_split, num_train = n - num_val, keep_best = 0, no_improvement_count = 0;
+    scyte_rng rng;
+    int* split = (int*)malloc(n*sizeof(int));
+    for(int i = 0; i < n; ++i) split[i] = i;
+    scyte_rng_seed(&rng, net->seed);
+    scyte_rng_shuffle(&rng, n, split);
+    scyte_sampler* train_sampler = scyte_make_sampler(num_train, split, 1, net->seed);
+    scyte_sampler* val_sampler = num_val > 0 ? scyte_make_sampler(num_val, split + num_train, 0, net->seed) : NULL;
+    // dropout and the like draw from the thread generators, see random.h
+    scyte_seed_thread_rngs(net->seed);
+    scyte_batch_loader* train_loader = scyte_make_batch_loader(data, train_sampler, batch_size, 3, net->augment);
+    scyte_batch_loader* val_loader = num_val > 0 ? scyte_make_batch_loader(data, val_sampler, batch_size, 3, NULL) : NULL;
+    float* X, *y;
+    scyte_replicas* replicas = net->num_threads > 1 ? scyte_make_replicas(net, net->num_threads) : NULL;
+
     float best_val_cost = FLT_MAX;
     for(int i = 0; i < num_epochs; ++i) {
         double t1 = time_now();
@@ -170,11 +375,12 @@ void scyte_train_network(scyte_network* net, scyte_optimizer_params params, int
         float train_cost = 0.f, val_cost = 0.f;
         // training
         switch_propagation_mode(net, 1);
+        if(replicas) scyte_sync_replica_params(replicas);
         while(num_processed < num_train) {
-            int bs = num_train - num_processed < batch_size ? num_train - num_processed : batch_size;
-            scyte_random_batch(data, bs, X, y);
-            scyte_set_batch_size(net->n, net->nodes, bs);
-            train_cost += bs*scyte_calculate_cost(net, 1);
+            int bs = scyte_next_batch(train_loader, &X, &y);
+            scyte_feed_net(net, INPUT, &X);
+            scyte_feed_net(net, GROUND_TRUTH, &y);
+            train_cost += bs*run_batch(net, replicas, bs, X, y, 1);
             optimizer_step(params, net, num_vars, g_prev, g_mean, g_var);
             num_processed += bs;
         }
@@ -183,11 +389,12 @@ void scyte_train_network(scyte_network* net, scyte_optimizer_params params, int
         // validation
         num_processed = 0;
         switch_propagation_mode(net, 0);
+        if(replicas) scyte_sync_replica_params(replicas);
         while(num_processed < num_val) {
-            int bs = num_val - num_processed < batch_size ? num_val - num_processed : batch_size;
-            scyte_random_batch(data, bs, X, y);
-            scyte_set_batch_size(net->n, net->nodes, bs);
-            val_cost += bs*scyte_calculate_cost(net, 0);
+            int bs = scyte_next_batch(val_loader, &X, &y);
+            scyte_feed_net(net, INPUT, &X);
+            scyte_feed_net(net, GROUND_TRUTH, &y);
+            val_cost += bs*run_batch(net, replicas, bs, X, y, 0);
             num_processed += bs;
         }
 #ifdef SCYTE_VERBOSE
@@ -214,21 +421,42 @@ void scyte_train_network(scyte_network* net, scyte_optimizer_params params, int
         memcpy(net->vals, best_vals, num_vars*sizeof(float));
         memcpy(net->consts, best_consts, num_consts*sizeof(float));
     }
-    free(best_vals); free(best_consts); free(X); free(y);
+    scyte_free_replicas(replicas);
+    scyte_free_batch_loader(train_loader); scyte_free_batch_loader(val_loader);
+    scyte_free_sampler(train_sampler); scyte_free_sampler(val_sampler);
+    free(split);
+    free(best_vals); free(best_consts);
+    free(g_prev); free(g_mean); free(g_var);
 }
 
 void scyte_free_network(scyte_network* net)
 {
     if(!net) return;
-    free(net->vals); free(net->deltas); free(net->consts);
+    if(net->mapped) munmap(net->mapped, net->mapped_size);
+    else free(net->vals), free(net->consts);
+    free(net->deltas);
+    free_execs(net);
+    scyte_free_scheduler(net->scheduler);
+    if(net->arena) {
+        // the op-nodes don't own their buffers, so keep scyte_free_graph from freeing them
+        for(int i = 0; i < net->n; ++i) {
+            scyte_node* node = net->nodes[i];
+            if(!scyte_is_operand(node)) node->vals = node->delta = NULL;
+        }
+        free(net->arena);
+    }
     scyte_free_graph(net->n, net->nodes);
     free(net);
 }
 
 void scyte_save_network(const char* filename, scyte_network* net)
 {
+    if(net->frozen) {
+        scyte_save_frozen_network(filename, net);
+        return;
+    }
     FILE* fp = fopen(filename, "wb");
-    scyte_set_batch_size(net->n, net->nodes, 1);
+    scyte_set_network_batch_size(net, 1, net->plan_mode);
     fwrite("SCYTE", sizeof(char), 5, fp); // magic number memes
     scyte_save_graph(fp, net->n, net->nodes);
     fwrite(net->vals, sizeof(float), get_num_vars(net), fp);
@@ -236,6 +464,56 @@ void scyte_save_network(const char* filename, scyte_network* net)
     fclose(fp);
 }
 
+static inline uint64_t align_offset(uint64_t offset, uint64_t alignment)
+{
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+static inline void write_padding(FILE* fp, uint64_t offset)
+{
+    while((uint64_t)ftell(fp) < offset) fputc(0, fp);
+}
+
+static void save_model(const char* filename, scyte_network* net, const char* magic, uint32_t version)
+{
+    FILE* fp = fopen(filename, "wb");
+    if(!fp) {
+        LOG_ERRORF("couldn't open file %s", filename);
+        return;
+    }
+    scyte_set_network_batch_size(net, 1, net->plan_mode);
+    scyte_model_header header = { .version = version, .header_size = sizeof(scyte_model_header) };
+    memcpy(header.magic, magic, sizeof(header.magic));
+    header.graph_offset = sizeof(scyte_model_header);
+    header.num_vars = get_num_vars(net), header.num_consts = get_num_consts(net);
+    fseek(fp, header.graph_offset, SEEK_SET);
+    scyte_save_graph(fp, net->n, net->nodes);
+    header.vars_offset = align_offset(ftell(fp), SCYTE_MODEL_PAGE_SIZE);
+    header.consts_offset = align_offset(header.vars_offset + header.num_vars*sizeof(float), SCYTE_MODEL_ALIGN);
+    write_padding(fp, header.vars_offset);
+    fwrite(net->vals, sizeof(float), header.num_vars, fp);
+    write_padding(fp, header.consts_offset);
+    fwrite(net->consts, sizeof(float), header.num_consts, fp);
+    // the header is written last, so a partially written file is never recognized as a model
+    fseek(fp, 0, SEEK_SET);
+    fwrite(&header, sizeof(scyte_model_header), 1, fp);
+    fclose(fp);
+}
+
+void scyte_save_mappable_network(const char* filename, scyte_network* net)
+{
+    save_model(filename, net, SCYTE_MODEL_MAGIC, SCYTE_MODEL_VERSION);
+}
+
+void scyte_save_frozen_network(const char* filename, scyte_network* net)
+{
+    if(!net->frozen) {
+        LOG_ERROR("couldn't save network, it must be frozen first, see scyte_freeze_network");
+        return;
+    }
+    save_model(filename, net, SCYTE_FROZEN_MAGIC, SCYTE_FROZEN_VERSION);
+}
+
 // synchronizes nodes in a network with global variables such as consts and variables
 static inline void sync_network(scyte_network* net)
 {
@@ -245,7 +523,7 @@ static inline void sync_network(scyte_network* net)
         int num_elements = scyte_num_elements(node);
         if(scyte_is_var(node)) {
             node->vals = &net->vals[j];
-            node->delta = &net->deltas[j];
+            node->delta = net->deltas ? &net->deltas[j] : NULL;
             j += num_elements;
         }
         else if(scyte_is_const(node)) {
@@ -255,26 +533,120 @@ static inline void sync_network(scyte_network* net)
     }
 }
 
+// reads and verifies the header of a mappable or a frozen model, returns 0 if fp is neither
+static int read_model_header(FILE* fp, scyte_model_header* header, int* frozen)
+{
+    if(fread(header, sizeof(scyte_model_header), 1, fp) != 1) return 0;
+    *frozen = memcmp(header->magic, SCYTE_FROZEN_MAGIC, sizeof(header->magic)) == 0;
+    if(!*frozen && memcmp(header->magic, SCYTE_MODEL_MAGIC, sizeof(header->magic)) != 0) return 0;
+    if(header->version != (*frozen ? SCYTE_FROZEN_VERSION : SCYTE_MODEL_VERSION)) {
+        LOG_ERRORF("couldn't load file: unsupported model version %u", header->version);
+        return 0;
+    }
+    return 1;
+}
+
+// loads the graph of a mappable model into a new network, without any weights
+static scyte_network* load_model_graph(FILE* fp, const scyte_model_header* header)
+{
+    scyte_network* net = (scyte_network*)calloc(1, sizeof(scyte_network));
+    fseek(fp, header->graph_offset, SEEK_SET);
+    net->nodes = scyte_load_graph(fp, &net->n);
+    if((uint64_t)get_num_vars(net) != header->num_vars || (uint64_t)get_num_consts(net) != header->num_consts) {
+        LOG_ERROR("couldn't load file: number of weights doesn't match the graph");
+        scyte_free_network(net);
+        return NULL;
+    }
+    return net;
+}
+
 scyte_network* scyte_load_network(const char* filename)
 {
     FILE* fp = fopen(filename, "rb");
-    // parse and verify magic number
-    char magic_str[5];
-    fread(magic_str, sizeof(char), 5, fp);
-    if(strncmp(magic_str, "SCYTE", 5) != 0) {
-        LOG_ERROR("couldn't load file: magic number didn't match");
-        fclose(fp);
+    if(!fp) {
+        LOG_ERRORF("couldn't open file %s", filename);
         return NULL;
     }
-    scyte_network* net = (scyte_network*)calloc(1, sizeof(scyte_network));
-    net->nodes = scyte_load_graph(fp, &net->n);
-    int num_vars = get_num_vars(net), num_consts = get_num_consts(net);
-    net->vals = (float*)malloc(num_vars*sizeof(float));
-    net->deltas = (float*)malloc(num_vars*sizeof(float));
-    net->consts = (float*)malloc(num_consts*sizeof(float));
-    fread(net->vals, sizeof(float), num_vars, fp);
-    fread(net->consts, sizeof(float), num_consts, fp);
+    scyte_network* net;
+    scyte_model_header header;
+    int frozen = 0;
+    if(read_model_header(fp, &header, &frozen)) {
+        if(!(net = load_model_graph(fp, &header))) {
+            fclose(fp);
+            return NULL;
+        }
+        net->frozen = frozen;
+        net->vals = (float*)malloc(header.num_vars*sizeof(float));
+        net->consts = (float*)malloc(header.num_consts*sizeof(float));
+        fseek(fp, header.vars_offset, SEEK_SET);
+        fread(net->vals, sizeof(float), header.num_vars, fp);
+        fseek(fp, header.consts_offset, SEEK_SET);
+        fread(net->consts, sizeof(float), header.num_consts, fp);
+    }
+    else {
+        // parse and verify magic number
+        char magic_str[5];
+        rewind(fp);
+        fread(magic_str, sizeof(char), 5, fp);
+        if(strncmp(magic_str, "SCYTE", 5) != 0) {
+            LOG_ERROR("couldn't load file: magic number didn't match");
+            fclose(fp);
+            return NULL;
+        }
+        net = (scyte_network*)calloc(1, sizeof(scyte_network));
+        net->nodes = scyte_load_graph(fp, &net->n);
+        int num_vars = get_num_vars(net), num_consts = get_num_consts(net);
+        net->vals = (float*)malloc(num_vars*sizeof(float));
+        net->consts = (float*)malloc(num_consts*sizeof(float));
+        fread(net->vals, sizeof(float), num_vars, fp);
+        fread(net->consts, sizeof(float), num_consts, fp);
+    }
+    if(!net->frozen) net->deltas = (float*)malloc(get_num_vars(net)*sizeof(float));
     sync_network(net);
+    plan_network(net, net->frozen ? SCYTE_PLAN_PREDICT : SCYTE_PLAN_TRAIN);
+    fclose(fp);
+    return net;
+}
+
+scyte_network* scyte_mmap_network(const char* filename)
+{
+    FILE* fp = fopen(filename, "rb");
+    if(!fp) {
+        LOG_ERRORF("couldn't open file %s", filename);
+        return NULL;
+    }
+    scyte_model_header header;
+    int frozen;
+    if(!read_model_header(fp, &header, &frozen)) {
+        LOG_ERROR("couldn't map file: not a mappable model, see scyte_save_mappable_network");
+        fclose(fp);
+        return NULL;
+    }
+    struct stat st;
+    uint64_t end = header.consts_offset + header.num_consts*sizeof(float);
+    if(fstat(fileno(fp), &st) != 0 || (uint64_t)st.st_size < end) {
+        LOG_ERROR("couldn't map file: file is truncated");
+        fclose(fp);
+        return NULL;
+    }
+    scyte_network* net = load_model_graph(fp, &header);
+    if(!net) {
+        fclose(fp);
+        return NULL;
+    }
+    // the weights are shared read-only with the page cache, and thereby with other processes
+    // mapping the same model. only the graph has been read from the file
+    void* mapped = mmap(NULL, end, PROT_READ, MAP_SHARED, fileno(fp), 0);
     fclose(fp);
+    if(mapped == MAP_FAILED) {
+        LOG_ERRORF("couldn't map file %s", filename);
+        scyte_free_network(net);
+        return NULL;
+    }
+    net->mapped = mapped, net->mapped_size = end, net->frozen = frozen;
+    net->vals = (float*)((char*)mapped + header.vars_offset);
+    net->consts = (float*)((char*)mapped + header.consts_offset);
+    sync_network(net);
+    plan_network(net, SCYTE_PLAN_PREDICT);
     return net;
 }
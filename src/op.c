@@ -1,5 +1,6 @@
 #include "op.h"
 
+#include "broadcast.h"
 #include "logger.h"
 
 #include <string.h>
@@ -80,6 +81,13 @@ char* scyte_get_op_string(scyte_op_type op_type)
         case L1_NORM: return "l1_norm";
         case MAXPOOL2D: return "maxpool2d";
         case CONV2D: return "conv2d";
+        case LAYOUT_TRANSFORM: return "layout_transform";
+        case AVGPOOL2D: return "avgpool2d";
+        case GLOBAL_AVGPOOL2D: return "global_avgpool2d";
+        case FUSED_ELEMENTWISE: return "fused_elementwise";
+        case TRANSPOSE: return "transpose";
+        case SOFTMAX_XENT: return "softmax_xent";
+        case SIGMOID_XENT: return "sigmoid_xent";
         case NOP: default: break;
     }
     return "unknown";
@@ -116,6 +124,13 @@ scyte_op_type scyte_get_op_type(char* s)
     if(strcmp(s, "l1_norm")) return L1_NORM;
     if(strcmp(s, "maxpool2d")) return MAXPOOL2D;
     if(strcmp(s, "conv2d")) return CONV2D;
+    if(strcmp(s, "layout_transform")) return LAYOUT_TRANSFORM;
+    if(strcmp(s, "avgpool2d")) return AVGPOOL2D;
+    if(strcmp(s, "global_avgpool2d")) return GLOBAL_AVGPOOL2D;
+    if(strcmp(s, "fused_elementwise")) return FUSED_ELEMENTWISE;
+    if(strcmp(s, "transpose")) return TRANSPOSE;
+    if(strcmp(s, "softmax_xent")) return SOFTMAX_XENT;
+    if(strcmp(s, "sigmoid_xent")) return SIGMOID_XENT;
     LOG_ERRORF("couldn't find operation %s", s);
     return NOP;
 }
@@ -152,6 +167,13 @@ void (*scyte_get_forward_function(scyte_op_type op_type)) (struct scyte_node*)
         case L1_NORM: return scyte_l1_norm_forward;
         case MAXPOOL2D: return scyte_maxpool2d_forward;
         case CONV2D: return scyte_conv2d_forward;
+        case LAYOUT_TRANSFORM: return scyte_layout_transform_forward;
+        case AVGPOOL2D: return scyte_avgpool2d_forward;
+        case GLOBAL_AVGPOOL2D: return scyte_global_avgpool2d_forward;
+        case FUSED_ELEMENTWISE: return scyte_fused_elementwise_forward;
+        case TRANSPOSE: return scyte_transpose_forward;
+        case SOFTMAX_XENT: return scyte_softmax_x_entropy_forward;
+        case SIGMOID_XENT: return scyte_sigmoid_x_entropy_forward;
         case NOP: default: return NULL;
     }
     return NULL;
@@ -189,6 +211,13 @@ void (*scyte_get_backward_function(scyte_op_type op_type)) (struct scyte_node*)
         case L1_NORM: return scyte_l1_norm_backward;
         case MAXPOOL2D: return scyte_maxpool2d_backward;
         case CONV2D: return scyte_conv2d_backward;
+        case LAYOUT_TRANSFORM: return scyte_layout_transform_backward;
+        case AVGPOOL2D: return scyte_avgpool2d_backward;
+        case GLOBAL_AVGPOOL2D: return scyte_global_avgpool2d_backward;
+        case FUSED_ELEMENTWISE: return scyte_fused_elementwise_backward;
+        case TRANSPOSE: return scyte_transpose_backward;
+        case SOFTMAX_XENT: return scyte_softmax_x_entropy_backward;
+        case SIGMOID_XENT: return scyte_sigmoid_x_entropy_backward;
         case NOP: default: return NULL;
     }
     return NULL;
@@ -226,11 +255,98 @@ int (*scyte_get_resync_function(scyte_op_type op_type)) (struct scyte_node*)
         case L1_NORM: return scyte_l1_norm_sync_dims;
         case MAXPOOL2D: return scyte_maxpool2d_sync_dims;
         case CONV2D: return scyte_conv2d_sync_dims;
+        case LAYOUT_TRANSFORM: return scyte_layout_transform_sync_dims;
+        case AVGPOOL2D: return scyte_avgpool2d_sync_dims;
+        case GLOBAL_AVGPOOL2D: return scyte_global_avgpool2d_sync_dims;
+        case FUSED_ELEMENTWISE: return scyte_fused_elementwise_sync_dims;
+        case TRANSPOSE: return scyte_transpose_sync_dims;
+        case SOFTMAX_XENT: return scyte_softmax_x_entropy_sync_dims;
+        case SIGMOID_XENT: return scyte_sigmoid_x_entropy_sync_dims;
         case NOP: default: return NULL;
     }
     return NULL;
 }
 
+int scyte_is_view(const scyte_node* node)
+{
+    if(scyte_is_operand(node)) return 0;
+    switch(node->op_type) {
+        case RESHAPE: return 1;
+        case SLICE: return scyte_slice_is_view(node);
+        case SELECT: return scyte_select_is_view(node);
+        case TRANSPOSE: return scyte_transpose_is_view(node);
+        default: return 0;
+    }
+}
+
+int scyte_reads_strided(const scyte_node* node, int i)
+{
+    switch(node->op_type) {
+        case TRANSPOSE: case FUSED_ELEMENTWISE: return 1;
+        case ADD: case SUB: case MULTIPLY: return scyte_broadcast_reads_strided(node);
+        case MATMUL: return scyte_matmul_reads_strided(node, i);
+        case CMATMUL: return scyte_cmatmul_reads_strided(node, i);
+        default: return 0;
+    }
+}
+
+int scyte_backprops_into(const scyte_node* node, int i)
+{
+    switch(node->op_type) {
+        // the fused cross-entropies backpropagate into the logits, past the prediction
+        case SOFTMAX_XENT: case SIGMOID_XENT: return i == 0;
+        default: return 1;
+    }
+}
+
+int scyte_matrix_trans(const scyte_node* node)
+{
+    if(scyte_is_contiguous(node)) return 0;
+    if(node->num_dims == 2 && node->strides[0] == 1 && node->strides[1] == node->shape[0]) return 1;
+    return -1;
+}
+
+// walks the row-major elements [first, first + n) of a node in memory laid out with the given
+// strides, row by row, and copies them to or adds them from dense
+static void strided_copy(const scyte_node* node, const int* strides, float* strided, int first, int n, float* dense, int scatter)
+{
+    int num_dims = node->num_dims, last = num_dims - 1, idx[SCYTE_MAX_DIMS];
+    long offset = 0;
+    for(int d = last, rest = first; d >= 0; --d) {
+        idx[d] = rest % node->shape[d], rest /= node->shape[d];
+        offset += (long)idx[d]*strides[d];
+    }
+    int stride = strides[last];
+    for(int k = 0; k < n;) {
+        int len = node->shape[last] - idx[last];
+        if(len > n - k) len = n - k;
+        float* row = strided + offset;
+        if(scatter) {
+            for(int j = 0; j < len; ++j) row[(long)j*stride] += dense[k + j];
+        }
+        else if(stride == 1) memcpy(dense + k, row, len*sizeof(float));
+        else {
+            for(int j = 0; j < len; ++j) dense[k + j] = row[(long)j*stride];
+        }
+        k += len, idx[last] += len, offset += (long)len*stride;
+        // carries into the outer axes
+        for(int d = last; d > 0 && idx[d] == node->shape[d]; --d) {
+            offset += strides[d - 1] - (long)idx[d]*strides[d];
+            idx[d] = 0, idx[d - 1]++;
+        }
+    }
+}
+
+void scyte_gather_strided(const scyte_node* node, const int* strides, const float* src, int first, int n, float* dst)
+{
+    strided_copy(node, strides, (float*)src, first, n, dst, 0);
+}
+
+void scyte_scatter_add_strided(const scyte_node* node, const int* strides, const float* src, int first, int n, float* dst)
+{
+    strided_copy(node, strides, dst, first, n, (float*)src, 1);
+}
+
 void get_reduced_dimensions(scyte_node* node, int axis, int* shape0, int* shape1)
 {
     *shape0 = *shape1 = 1;
@@ -0,0 +1,51 @@
+#include "ops/avgpool2d.h"
+
+#include "pool.h"
+#include "op.h"
+#include "logger.h"
+
+#include <stdlib.h>
+
+static inline scyte_pool get_pool(const scyte_node* node)
+{
+    int* pool_params = (int*)node->params;
+    scyte_pool pool = { SCYTE_POOL_AVG, pool_params[0], pool_params[0], pool_params[1], pool_params[2] };
+    return pool;
+}
+
+int scyte_avgpool2d_sync_dims(scyte_node* node)
+{
+    scyte_pool pool = get_pool(node);
+    return scyte_pool_sync_dims(&pool, node->children[0], node);
+}
+
+scyte_node* scyte_avgpool2d(scyte_node* x, int size, int stride, int padding)
+{
+    if(x->num_dims != 4) {
+        LOG_ERRORF("x has %d dimension(s), it must have shape NCHW", x->num_dims);
+        return NULL;
+    }
+    scyte_node* node = make_op1_node(AVGPOOL2D, x);
+    node->forward = scyte_avgpool2d_forward, node->backward = scyte_avgpool2d_backward;
+    int* pool_params = (int*)calloc(3, sizeof(int));
+    pool_params[0] = size, pool_params[1] = stride, pool_params[2] = padding;
+    node->params = pool_params;
+    node->params_size = 3*sizeof(int);
+    if(!scyte_avgpool2d_sync_dims(node)) {
+        free_op_node(node);
+        return NULL;
+    }
+    return node;
+}
+
+void scyte_avgpool2d_forward(scyte_node* node)
+{
+    scyte_pool pool = get_pool(node);
+    scyte_pool_forward(&pool, node->children[0], node, NULL);
+}
+
+void scyte_avgpool2d_backward(scyte_node* node)
+{
+    scyte_pool pool = get_pool(node);
+    scyte_pool_backward(&pool, node->children[0], node, NULL);
+}
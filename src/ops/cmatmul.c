@@ -1,10 +1,12 @@
 #include "ops/cmatmul.h"
 
+#include "fusion.h"
 #include "logger.h"
 #include "blas.h"
 #include "op.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 
 #define MAX(x, y) (((x) > (y)) ? (x) : (y))
 
@@ -30,6 +32,10 @@ int scyte_cmatmul_sync_dims(scyte_node* node)
         LOG_ERRORF("dimensions (%d != %d) were not properly synced, returning NULL\n", num_cols_x, num_cols_y);
         return 0;
     }
+    if(node->num_children > 2 && scyte_num_elements(node->children[2]) != num_rows_y) {
+        LOG_ERRORF("the bias has %d elements, expected %d\n", scyte_num_elements(node->children[2]), num_rows_y);
+        return 0;
+    }
     node->num_dims = 2;
     node->shape[0] = num_rows_x, node->shape[1] = num_rows_y;
     return 1;
@@ -46,6 +52,43 @@ scyte_node* scyte_cmatmul(scyte_node* x, scyte_node* y)
     return node;
 }
 
+int scyte_cmatmul_reads_strided(const scyte_node* node, int i)
+{
+    // the gemm reads transposed matrices if both inputs are matrices of the same width, so that
+    // their rows are their first axis, whatever the batch size
+    scyte_node* x = node->children[0], *y = node->children[1];
+    if(i > 1 || x->num_dims != 2 || y->num_dims != 2 || x->shape[1] != y->shape[1]) return 0;
+    return scyte_matrix_trans(node->children[i]) >= 0;
+}
+
+scyte_activation scyte_get_cmatmul_activation(const scyte_node* node)
+{
+    return node->params_size >= sizeof(int) ? ((int*)node->params)[0] : SCYTE_ACTIVATION_NONE;
+}
+
+int scyte_set_cmatmul_epilogue(scyte_node* node, scyte_node* bias, scyte_activation act)
+{
+    if(node->num_children > 2) {
+        LOG_ERROR("the cmatmul already has a bias");
+        return 0;
+    }
+    if(bias) {
+        node->children = (scyte_node**)realloc(node->children, 3*sizeof(scyte_node*));
+        node->children[node->num_children++] = bias;
+        if(!scyte_cmatmul_sync_dims(node)) {
+            node->num_children--;
+            return 0;
+        }
+        scyte_propagate_gradient_mark(node);
+    }
+    if(node->params_size < sizeof(int)) {
+        node->params = realloc(node->params, sizeof(int));
+        node->params_size = sizeof(int);
+    }
+    ((int*)node->params)[0] = act;
+    return 1;
+}
+
 void scyte_cmatmul_forward(scyte_node* node)
 {
     scyte_node* x = node->children[0], *y = node->children[1];
@@ -55,11 +98,16 @@ void scyte_cmatmul_forward(scyte_node* node)
     get_rows_cols(x, num_cols, &num_rows_x, &num_cols_x);
     get_rows_cols(y, num_cols, &num_rows_y, &num_cols_y);
 
-    set_cpu(num_rows_x*num_rows_y, 0.f, node->vals);
+    // the gemm accumulates onto the bias
+    if(node->num_children > 2) {
+        for(int i = 0; i < num_rows_x; ++i) copy_cpu(num_rows_y, node->children[2]->vals, node->vals + i*num_rows_y);
+    }
+    else set_cpu(num_rows_x*num_rows_y, 0.f, node->vals);
     if(x->vals != NULL && y->vals != NULL) {
-        gemm_cpu(0, 1, num_rows_x, num_rows_y, num_cols,
+        gemm_cpu(scyte_matrix_trans(x), !scyte_matrix_trans(y), num_rows_x, num_rows_y, num_cols,
                 1.f, x->vals, y->vals, 1.f, node->vals);
     }
+    scyte_activate(num_rows_x*num_rows_y, scyte_get_cmatmul_activation(node), node->vals);
 }
 
 void scyte_cmatmul_backward(scyte_node* node)
@@ -71,12 +119,19 @@ void scyte_cmatmul_backward(scyte_node* node)
     get_rows_cols(x, num_cols, &num_rows_x, &num_cols_x);
     get_rows_cols(y, num_cols, &num_rows_y, &num_cols_y);
 
+    // the delta is only read by this node, so it's turned into the gradient before the activation in place
+    scyte_activation_gradient(num_rows_x*num_rows_y, scyte_get_cmatmul_activation(node), node->vals, node->delta);
+    if(node->num_children > 2 && scyte_has_gradient(node->children[2])) {
+        for(int i = 0; i < num_rows_x; ++i) axpy_cpu(num_rows_y, 1.f, node->delta + i*num_rows_y, node->children[2]->delta);
+    }
+    // transposed inputs take their gradient transposed
+    int trans_x = scyte_matrix_trans(x), trans_y = scyte_matrix_trans(y);
     if(scyte_has_gradient(x) && y->vals != NULL) {
-        gemm_cpu(0, 0, num_rows_x, num_cols, num_rows_y,
-                1.f, node->delta, y->vals, 1.f, x->delta);
+        gemm_acc_cpu(0, trans_y, trans_x, num_rows_x, num_cols, num_rows_y,
+                1.f, node->delta, y->vals, x->delta);
     }
     if(scyte_has_gradient(y) && x->vals != NULL) {
-        gemm_cpu(1, 0, num_rows_y, num_cols, num_rows_x,
-                1.f, node->delta, x->vals, 1.f, y->delta);
+        gemm_acc_cpu(1, trans_x, trans_y, num_rows_y, num_cols, num_rows_x,
+                1.f, node->delta, x->vals, y->delta);
     }
 }
@@ -2,10 +2,209 @@
 
 #include "op.h"
 #include "blas.h"
+#include "blas_kernels.h"
+#include "fusion.h"
+#include "layout.h"
 #include "logger.h"
+#include "utils.h"
 
 #include <assert.h>
+#include <float.h>
+#include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define NUM_CONV_PARAMS 5 // size, stride, padding, the selected algorithm and the fused activation
+#define CONV_ALGO_PARAM 3
+#define CONV_ACTIVATION_PARAM 4
+
+// upper bound on the im2col workspace of a conv node, see scyte_set_conv_workspace_limit
+static size_t workspace_limit = 64 << 20;
+
+void scyte_set_conv_workspace_limit(size_t bytes)
+{
+    workspace_limit = bytes;
+}
+
+// 1x1 convolutions with unit stride and no padding don't need im2col, the image is its own column matrix
+static inline int is_pointwise(int size, int stride, int pad)
+{
+    return size == 1 && stride == 1 && pad == 0;
+}
+
+// Minibatches with at least one image per thread are spread over the threads image by image, every
+// thread with its own slice of the workspace and gemms of its own, as long as the im2col columns of
+// all the threads fit the workspace limit. Otherwise the threads share each gemm, which only scales
+// when the gemms are large. Returns the number of threads the images are spread over
+static int conv_batch_threads(const scyte_node* node)
+{
+#ifdef _OPENMP
+    const scyte_node* x = node->children[0];
+    int threads = omp_in_parallel() ? 1 : omp_get_max_threads();
+    int size = ((int*)node->params)[0], stride = ((int*)node->params)[1], pad = ((int*)node->params)[2];
+    size_t columns = is_pointwise(size, stride, pad) ? 0 : (size_t)size*size*x->shape[1]*node->shape[2]*node->shape[3];
+    if(threads > 1 && x->shape[0] >= threads && threads*columns*sizeof(float) <= workspace_limit) return threads;
+#endif
+    return 1;
+}
+
+// the slice of the workspace of the calling thread, among the threads the images are spread over
+static inline int conv_thread_num(int threads)
+{
+#ifdef _OPENMP
+    if(threads > 1) return omp_get_thread_num();
+#endif
+    return 0;
+}
+
+// Winograd F(mxm,3x3) computes a m x m tile of the output from a (m+2) x (m+2) tile of the input,
+// trading most of the multiplications for additions: Y = AT*[(G*g*GT) . (BT*d*B)]*A
+typedef struct {
+    int m, alpha;       // output tile size, input tile size
+    const float* BT;    // alpha x alpha, input transform
+    const float* G;     // alpha x 3, filter transform
+    const float* AT;    // m x alpha, output transform
+} winograd_transform;
+
+static const float winograd2_BT[] = {
+    1,  0, -1,  0,
+    0,  1,  1,  0,
+    0, -1,  1,  0,
+    0,  1,  0, -1,
+};
+static const float winograd2_G[] = {
+    1.f,  0.f, 0.f,
+    .5f,  .5f, .5f,
+    .5f, -.5f, .5f,
+    0.f,  0.f, 1.f,
+};
+static const float winograd2_AT[] = {
+    1, 1,  1,  0,
+    0, 1, -1, -1,
+};
+static const winograd_transform winograd2 = { 2, 4, winograd2_BT, winograd2_G, winograd2_AT };
+
+static const float winograd4_BT[] = {
+    4,  0, -5,  0, 1, 0,
+    0, -4, -4,  1, 1, 0,
+    0,  4, -4, -1, 1, 0,
+    0, -2, -1,  2, 1, 0,
+    0,  2, -1, -2, 1, 0,
+    0,  4,  0, -5, 0, 1,
+};
+static const float winograd4_G[] = {
+     1.f/4,      0.f,     0.f,
+    -1.f/6,  -1.f/6,  -1.f/6,
+    -1.f/6,   1.f/6,  -1.f/6,
+     1.f/24,  1.f/12,  1.f/6,
+     1.f/24, -1.f/12,  1.f/6,
+     0.f,     0.f,     1.f,
+};
+static const float winograd4_AT[] = {
+    1, 1,  1, 1,  1, 0,
+    0, 1, -1, 2, -2, 0,
+    0, 1,  1, 4,  4, 0,
+    0, 1, -1, 8, -8, 1,
+};
+static const winograd_transform winograd4 = { 4, 6, winograd4_BT, winograd4_G, winograd4_AT };
+
+static inline int is_winograd(int size, int stride)
+{
+    return size == 3 && stride == 1;
+}
+
+// the transformed filters (alpha^2 x F x C), then for every thread the transformed input tiles of an
+// image (alpha^2 x C x T) and their products (alpha^2 x F x T)
+static inline size_t winograd_workspace(const winograd_transform* wt, int filters, int channels, int out_h, int out_w, int threads)
+{
+    size_t tiles = (size_t)((out_h + wt->m - 1) / wt->m)*((out_w + wt->m - 1) / wt->m);
+    return (size_t)wt->alpha*wt->alpha*(filters*channels + threads*(channels + filters)*tiles);
+}
+
+// Direct convolution without any lowering. Every step computes a register tile of DIRECT_WIDTH
+// outputs of a row for DIRECT_FILTERS filters, so each input value loaded feeds several filters.
+// The filters are packed so that the weights of a block are contiguous, and the image is copied
+// with its padding so the tiles need no bounds checks.
+#define DIRECT_FILTERS 4
+#define DIRECT_WIDTH 8
+
+// the padded image of a thread, the last tile of a row may read past its end
+static inline size_t direct_padded_size(int channels, int size, int stride, int pad, int in_h, int in_w)
+{
+    return (size_t)channels*(in_h + 2*pad)*(in_w + 2*pad) + DIRECT_WIDTH*stride + size;
+}
+
+static inline size_t direct_workspace(int filters, int channels, int size, int stride, int pad, int in_h, int in_w, int threads)
+{
+    size_t packed = (size_t)(filters + DIRECT_FILTERS - 1) / DIRECT_FILTERS*DIRECT_FILTERS*channels*size*size;
+    return packed + threads*direct_padded_size(channels, size, stride, pad, in_h, in_w);
+}
+
+// the staging buffer of the pixels of a phase of the transposed convolution with stride > 1
+static inline size_t backward_staging_size(int channels, int stride, int in_h, int in_w)
+{
+    return stride > 1 ? (size_t)channels*((in_h + stride - 1) / stride)*((in_w + stride - 1) / stride) : 0;
+}
+
+// the flipped filters of a phase and a staging buffer per thread, see conv_backward_data. Spread over
+// the threads, the gradient of the filters takes a partial sum per thread, see conv_backward_filter
+static inline size_t backward_workspace(int filters, int channels, int size, int stride, int in_h, int in_w, int threads)
+{
+    size_t data = (size_t)channels*filters*size*size + threads*backward_staging_size(channels, stride, in_h, in_w);
+    size_t filter = threads > 1 ? (size_t)threads*filters*channels*size*size : 0;
+    return data > filter ? data : filter;
+}
+
+// On a single thread, the batch is processed in chunks of images, whose im2col columns are laid out
+// next to each other, so that every chunk takes one large gemm rather than one small gemm per image.
+// The workspace holds the columns (k x chunk*n), plus the gemm output in filter-major order
+// (m x chunk*n) if chunk > 1. Spread over the threads, every thread has the columns of one image.
+// returns the number of floats of the workspace, and the number of images per chunk
+static size_t algo_workspace(scyte_node* node, int* num_images)
+{
+    scyte_node* x = node->children[0];
+    int* conv_params = (int*)node->params;
+    int size = conv_params[0], stride = conv_params[1], pad = conv_params[2];
+    int m = node->shape[1], k = size*size*x->shape[1], n = node->shape[2]*node->shape[3];
+    size_t per_image = (size_t)(k + m)*n*sizeof(float);
+    int threads = conv_batch_threads(node);
+    int chunk = threads > 1 ? 1 : workspace_limit / per_image;
+    if(chunk > node->shape[0]) chunk = node->shape[0];
+    if(chunk < 1) chunk = 1;
+    size_t workspace = chunk == 1 ? (is_pointwise(size, stride, pad) ? 0 : (size_t)threads*k*n) : (size_t)(k + m)*chunk*n;
+    size_t direct = direct_workspace(m, x->shape[1], size, stride, pad, x->shape[2], x->shape[3], threads);
+    if(direct > workspace) workspace = direct;
+    size_t backward = backward_workspace(m, x->shape[1], size, stride, x->shape[2], x->shape[3], threads);
+    if(backward > workspace) workspace = backward;
+    // the filters packed for the other layouts, and the NHWC output of an image in the blocked ones
+    size_t blocked = (size_t)m*k + (x->layout == SCYTE_NHWC ? 0 : (size_t)m*n);
+    if(x->layout != SCYTE_NCHW && blocked > workspace) workspace = blocked;
+    if(is_winograd(size, stride)) {
+        const winograd_transform* transforms[] = { &winograd2, &winograd4 };
+        for(int i = 0; i < 2; ++i) {
+            size_t w = winograd_workspace(transforms[i], m, x->shape[1], node->shape[2], node->shape[3], threads);
+            if(w > workspace) workspace = w;
+        }
+    }
+    *num_images = chunk;
+    return workspace;
+}
+
+// returns the number of images per chunk, and makes sure node->tmp is large enough for it and for
+// the other algorithms. In the other layouts, the NCHW copies the gradients are computed on follow
+// the workspace, see scyte_conv2d_backward
+static int conv_workspace(scyte_node* node)
+{
+    int chunk;
+    size_t workspace = algo_workspace(node, &chunk);
+    scyte_node* x = node->children[0];
+    if(x->layout != SCYTE_NCHW) workspace += scyte_num_elements(node) + scyte_num_elements(x);
+    node->tmp = (float*)realloc(node->tmp, (workspace > 0 ? workspace : 1)*sizeof(float));
+    return chunk;
+}
 
 int scyte_conv2d_sync_dims(scyte_node* node)
 {
@@ -18,18 +217,23 @@ int scyte_conv2d_sync_dims(scyte_node* node)
         LOG_ERROR("input channels of filter and input must be the same");
         return 0;
     }
+    // the output is in the layout of the input
+    if(!scyte_layout_supported(x->layout, w->shape[0])) {
+        LOG_ERRORF("%d filters can't be stored in layout %s", w->shape[0], scyte_layout_string(x->layout));
+        return 0;
+    }
     int* conv_params = (int*)node->params;
     int size = conv_params[0], stride = conv_params[1], padding = conv_params[2];
-    int in_c = x->shape[1], in_h = x->shape[2], in_w = x->shape[3];
+    int in_h = x->shape[2], in_w = x->shape[3];
 
     node->num_dims = 4;
     node->shape[0] = x->shape[0]; // batch size
     node->shape[1] = w->shape[0]; // channels
     node->shape[2] = (in_h + 2*padding - size) / stride + 1; // height
     node->shape[3] = (in_w + 2*padding - size) / stride + 1; // width
+    node->layout = x->layout;
 
-    // buffer to store the results from im2col and col2im
-    node->tmp = (float*)realloc(node->tmp, in_c*node->shape[2]*node->shape[3]*size*size*sizeof(float));
+    conv_workspace(node); // buffer for the im2col columns and the other algorithms' transforms
     return 1;
 }
 
@@ -38,10 +242,12 @@ static inline void set_conv_params(scyte_node* node, int stride, int padding)
     scyte_node* w = node->children[1];
     assert(w->shape[2] == w->shape[3]);
     int size = w->shape[2];
-    int* conv_params = (int*)calloc(3, sizeof(int));
+    int* conv_params = (int*)calloc(NUM_CONV_PARAMS, sizeof(int));
     conv_params[0] = size, conv_params[1] = stride, conv_params[2] = padding;
+    conv_params[CONV_ALGO_PARAM] = SCYTE_CONV_AUTO;
+    conv_params[CONV_ACTIVATION_PARAM] = SCYTE_ACTIVATION_NONE;
     node->params = conv_params;
-    node->params_size = 3*sizeof(int);
+    node->params_size = NUM_CONV_PARAMS*sizeof(int);
 }
 
 scyte_node* scyte_conv2d(scyte_node* x, scyte_node* w, int stride, int padding)
@@ -66,9 +272,10 @@ static inline float im2col_get_pixel(float* im, int height, int width, int chann
 }
 
 // from https://github.com/pjreddie/darknet/blob/master/src/im2col.c
+// extended with the row stride ldcol of the column matrix, so the columns of several images can be interleaved
 void im2col(float* data_im,
      int channels,  int height,  int width,
-     int ksize,  int stride, int pad, float* data_col)
+     int ksize,  int stride, int pad, float* data_col, int ldcol)
 {
     int height_col = (height + 2*pad - ksize) / stride + 1;
     int width_col = (width + 2*pad - ksize) / stride + 1;
@@ -79,7 +286,7 @@ void im2col(float* data_im,
         for(int h = 0; h < height_col; ++h) {
             for (int w = 0; w < width_col; ++w) {
                 int im_row = h_offset + h*stride, im_col = w_offset + w*stride;
-                int col_index = (c*height_col + h)*width_col + w;
+                int col_index = c*ldcol + h*width_col + w;
                 data_col[col_index] = im2col_get_pixel(data_im, height, width, channels, im_row, im_col, c_im, pad);
             }
         }
@@ -87,7 +294,7 @@ void im2col(float* data_im,
 }
 
 
-void scyte_conv2d_forward(scyte_node* node)
+static void conv_forward_gemm(scyte_node* node)
 {
     scyte_node* x = node->children[0], *w = node->children[1];
     int num_filters = w->shape[0];
@@ -96,49 +303,126 @@ void scyte_conv2d_forward(scyte_node* node)
     int* conv_params = (int*)node->params;
     int size = conv_params[0], stride = conv_params[1], pad = conv_params[2];
 
-    if(!node->tmp) node->tmp = (float*)calloc(in_c*out_h*out_w*size*size, sizeof(float));
-
+    int chunk = conv_workspace(node), threads = conv_batch_threads(node);
     int m = num_filters, k = size*size*in_c, n = out_w*out_h;
-    set_cpu(batch_size*n*m, 0.f, node->vals);
-    for(int i = 0; i < batch_size; ++i) {
-        float* a = w->vals, *b = node->tmp, *c = node->vals + i*n*m;
+    // spread over the threads, the chunks are single images
+    #pragma omp parallel for num_threads(threads) if(threads > 1)
+    for(int i = 0; i < batch_size; i += chunk) {
+        int num_images = batch_size - i < chunk ? batch_size - i : chunk;
+        int ldcol = num_images*n;
+        float* a = w->vals, *b = (float*)node->tmp + (size_t)conv_thread_num(threads)*k*n, *c = node->vals + i*n*m;
         float* im = x->vals + i*in_c*in_h*in_w;
-        if(size == 1) b = im;
-        else im2col(im, in_c, in_h, in_w, size, stride, pad, b);
-        gemm_cpu(0, 0, m, n, k, 1.f, a, b, 1.f, c);
+        if(num_images == 1 && is_pointwise(size, stride, pad)) b = im;
+        else {
+            for(int j = 0; j < num_images; ++j) {
+                im2col(im + j*in_c*in_h*in_w, in_c, in_h, in_w, size, stride, pad, b + j*n, ldcol);
+            }
+        }
+        if(num_images > 1) c = (float*)node->tmp + k*ldcol;
+        gemm_cpu(0, 0, m, ldcol, k, 1.f, a, b, 0.f, c);
+        // the gemm output is filter-major (m x num_images*n), the node's values are image-major
+        for(int j = 0; num_images > 1 && j < num_images; ++j) {
+            for(int f = 0; f < m; ++f) {
+                memcpy(node->vals + ((i + j)*m + f)*n, c + f*ldcol + j*n, n*sizeof(float));
+            }
+        }
     }
 }
 
-static inline void col2im_add_pixel(float* im, int height, int width, int channels,
-                        int row, int col, int channel, int pad, float val)
+// out = L*X*LT, with L r x s and X s x s
+static inline void winograd_sandwich(const float* L, int r, int s, const float* X, float* out)
 {
-    row -= pad, col -= pad;
-    if (row < 0 || col < 0 || row >= height || col >= width) return;
-    im[col + width*(row + height*channel)] += val;
+    float tmp[6*6];
+    for(int i = 0; i < r; ++i) {
+        for(int j = 0; j < s; ++j) {
+            float sum = 0.f;
+            for(int k = 0; k < s; ++k) sum += L[i*s + k]*X[k*s + j];
+            tmp[i*s + j] = sum;
+        }
+    }
+    for(int i = 0; i < r; ++i) {
+        for(int j = 0; j < r; ++j) {
+            float sum = 0.f;
+            for(int k = 0; k < s; ++k) sum += tmp[i*s + k]*L[j*s + k];
+            out[i*r + j] = sum;
+        }
+    }
 }
 
-void col2im(float* data_col,
-         int channels,  int height,  int width,
-         int ksize,  int stride, int pad, float* data_im)
+// Every element e of the transformed tiles is an independent F x C by C x T product, so the
+// elementwise products of all filters, channels and tiles of an image become alpha^2 gemms
+static void conv_forward_winograd(scyte_node* node, const winograd_transform* wt)
 {
-    int height_col = (height + 2*pad - ksize) / stride + 1;
-    int width_col = (width + 2*pad - ksize) / stride + 1;
-    int channels_col = channels*ksize*ksize;
-    for(int c = 0; c < channels_col; ++c) {
-        int w_offset = c % ksize, h_offset = (c / ksize) % ksize;
-        int c_im = c / ksize / ksize;
-        for(int h = 0; h < height_col; ++h) {
-            for(int w = 0; w < width_col; ++w) {
-                int im_row = h_offset + h*stride, im_col = w_offset + w*stride;
-                int col_index = (c * height_col + h) * width_col + w;
-                double val = data_col[col_index];
-                col2im_add_pixel(data_im, height, width, channels, im_row, im_col, c_im, pad, val);
+    scyte_node* x = node->children[0], *w = node->children[1];
+    int num_filters = w->shape[0];
+    int batch_size = x->shape[0], in_c = x->shape[1], in_h = x->shape[2], in_w = x->shape[3];
+    int out_h = node->shape[2], out_w = node->shape[3];
+    int pad = ((int*)node->params)[2];
+
+    int m = wt->m, alpha = wt->alpha, num_elems = alpha*alpha;
+    int tiles_w = (out_w + m - 1) / m, num_tiles = ((out_h + m - 1) / m)*tiles_w;
+    int fc = num_filters*in_c, ct = in_c*num_tiles, ft = num_filters*num_tiles;
+    int threads = conv_batch_threads(node);
+    float* U = (float*)node->tmp;
+
+    #pragma omp parallel for
+    for(int i = 0; i < fc; ++i) {
+        float u[6*6];
+        winograd_sandwich(wt->G, alpha, 3, w->vals + i*9, u);
+        for(int e = 0; e < num_elems; ++e) U[e*fc + i] = u[e];
+    }
+    // spread over the threads, the loops of every image run on the thread of the image
+    #pragma omp parallel for num_threads(threads) if(threads > 1)
+    for(int b = 0; b < batch_size; ++b) {
+        float* im = x->vals + b*in_c*in_h*in_w, *out = node->vals + b*num_filters*out_h*out_w;
+        float* V = U + num_elems*fc + (size_t)conv_thread_num(threads)*num_elems*(ct + ft), *M = V + num_elems*ct;
+        #pragma omp parallel for
+        for(int i = 0; i < ct; ++i) {
+            int c = i / num_tiles, t = i % num_tiles;
+            int row = (t / tiles_w)*m - pad, col = (t % tiles_w)*m - pad;
+            float d[6*6], v[6*6];
+            for(int r = 0; r < alpha; ++r) {
+                for(int q = 0; q < alpha; ++q) {
+                    int inside = row + r >= 0 && row + r < in_h && col + q >= 0 && col + q < in_w;
+                    d[r*alpha + q] = inside ? im[(c*in_h + row + r)*in_w + col + q] : 0.f;
+                }
+            }
+            winograd_sandwich(wt->BT, alpha, alpha, d, v);
+            for(int e = 0; e < num_elems; ++e) V[e*ct + i] = v[e];
+        }
+        for(int e = 0; e < num_elems; ++e) {
+            gemm_cpu(0, 0, num_filters, num_tiles, in_c, 1.f, U + e*fc, V + e*ct, 0.f, M + e*ft);
+        }
+        #pragma omp parallel for
+        for(int i = 0; i < ft; ++i) {
+            int f = i / num_tiles, t = i % num_tiles;
+            int row = (t / tiles_w)*m, col = (t % tiles_w)*m;
+            float p[6*6], y[4*4];
+            for(int e = 0; e < num_elems; ++e) p[e] = M[e*ft + i];
+            winograd_sandwich(wt->AT, m, alpha, p, y);
+            for(int r = 0; r < m && row + r < out_h; ++r) {
+                for(int q = 0; q < m && col + q < out_w; ++q) {
+                    out[(f*out_h + row + r)*out_w + col + q] = y[r*m + q];
+                }
             }
         }
     }
 }
 
-void scyte_conv2d_backward(scyte_node* node)
+// inlined with a constant unit stride, for which the loads of a tile are contiguous
+static inline __attribute__((always_inline)) void direct_tile(float acc[DIRECT_FILTERS][DIRECT_WIDTH],
+        const float* row, const float* weights, int size, int stride)
+{
+    for(int kj = 0; kj < size; ++kj) {
+        for(int f = 0; f < DIRECT_FILTERS; ++f) {
+            float weight = weights[kj*DIRECT_FILTERS + f];
+            for(int v = 0; v < DIRECT_WIDTH; ++v) acc[f][v] += weight*row[kj + v*stride];
+        }
+    }
+}
+
+// Direct convolution without any lowering, see direct_workspace
+static void conv_forward_direct(scyte_node* node)
 {
     scyte_node* x = node->children[0], *w = node->children[1];
     int num_filters = w->shape[0];
@@ -147,21 +431,503 @@ void scyte_conv2d_backward(scyte_node* node)
     int* conv_params = (int*)node->params;
     int size = conv_params[0], stride = conv_params[1], pad = conv_params[2];
 
-    int m = num_filters, n = size*size*in_c, k = out_w*out_h;
-    for(int i = 0; i < batch_size; ++i) {
-        float* a = node->delta + i*m*k, *b = node->tmp, *c = w->delta;
-        float* im  = x->vals + i*in_c*in_h*in_w;
-        float* imd = x->delta + i*in_c*in_h*in_w; // delta
-        if(scyte_has_gradient(w)) {
-            if(size == 1) b = im;
-            else im2col(im, in_c, in_h, in_w, size, stride, pad, b);
-            gemm_cpu(0, 1, m, n, k, 1.f, a, b, 1.f, c);
-        }
-        if(scyte_has_gradient(x)) {
-            a = w->vals, b = node->delta + i*m*k, c = node->tmp;
-            if(size == 1) c = imd;
-            gemm_cpu(1, 0, n, k, m, 1.f, a, b, 0.f, c);
-            if(size != 1) col2im(c, in_c, in_h, in_w, size, stride, pad, imd);
+    int ksize = size*size, num_blocks = (num_filters + DIRECT_FILTERS - 1) / DIRECT_FILTERS;
+    int padded_h = in_h + 2*pad, padded_w = in_w + 2*pad, threads = conv_batch_threads(node);
+    size_t padded_size = direct_padded_size(in_c, size, stride, pad, in_h, in_w);
+    float* packed = (float*)node->tmp, *padding = packed + num_blocks*DIRECT_FILTERS*in_c*ksize;
+    // [block][c][ki][kj][filter of the block], the filters past num_filters are zero
+    for(int f = 0; f < num_blocks*DIRECT_FILTERS; ++f) {
+        for(int i = 0; i < in_c*ksize; ++i) {
+            float weight = f < num_filters ? w->vals[f*in_c*ksize + i] : 0.f;
+            packed[((f / DIRECT_FILTERS)*in_c*ksize + i)*DIRECT_FILTERS + f % DIRECT_FILTERS] = weight;
         }
     }
+    // only the inside of the padded images is ever written
+    memset(padding, 0, threads*padded_size*sizeof(float));
+
+    #pragma omp parallel for num_threads(threads) if(threads > 1)
+    for(int b = 0; b < batch_size; ++b) {
+        const float* im = x->vals + b*in_c*in_h*in_w;
+        float* padded = padding + conv_thread_num(threads)*padded_size;
+        for(int c = 0; c < in_c; ++c) {
+            for(int h = 0; h < in_h; ++h) {
+                memcpy(padded + (c*padded_h + h + pad)*padded_w + pad, im + (c*in_h + h)*in_w, in_w*sizeof(float));
+            }
+        }
+        float* out = node->vals + b*num_filters*out_h*out_w;
+        #pragma omp parallel for
+        for(int i = 0; i < num_blocks*out_h; ++i) {
+            int block = i / out_h, oh = i % out_h;
+            for(int ow = 0; ow < out_w; ow += DIRECT_WIDTH) {
+                float acc[DIRECT_FILTERS][DIRECT_WIDTH] = { { 0.f } };
+                for(int c = 0; c < in_c; ++c) {
+                    for(int ki = 0; ki < size; ++ki) {
+                        const float* row = padded + (c*padded_h + oh*stride + ki)*padded_w + ow*stride;
+                        const float* weights = packed + ((block*in_c + c)*ksize + ki*size)*DIRECT_FILTERS;
+                        if(stride == 1) direct_tile(acc, row, weights, size, 1);
+                        else direct_tile(acc, row, weights, size, stride);
+                    }
+                }
+                int width = out_w - ow < DIRECT_WIDTH ? out_w - ow : DIRECT_WIDTH;
+                for(int f = 0; f < DIRECT_FILTERS && block*DIRECT_FILTERS + f < num_filters; ++f) {
+                    memcpy(out + ((block*DIRECT_FILTERS + f)*out_h + oh)*out_w + ow, acc[f], width*sizeof(float));
+                }
+            }
+        }
+    }
+}
+
+// Implicit im2col of images whose channels are stored innermost, in NHWC or a blocked layout, for
+// gemm_panels_cpu: row (image, oh, ow), column (channel block, ki, kj, channel), so the channels of
+// a block are contiguous in both. NHWC is a single block of all the channels
+typedef struct {
+    const float* im;
+    scyte_layout_strides strides;
+    int height, width;
+    int size, stride, pad;
+    int out_h, out_w;
+} blocked_columns;
+
+static void pack_blocked_columns(const void* ctx, int first, int k0, int n, int kc, int width, float* packed)
+{
+    const blocked_columns* cols = (const blocked_columns*)ctx;
+    const scyte_layout_strides* s = &cols->strides;
+    int block = s->block, ksize = cols->size*cols->size, r;
+    for(r = 0; r < n; ++r) {
+        int p = first + r, ow = p % cols->out_w, oh = p / cols->out_w % cols->out_h, b = p / (cols->out_w*cols->out_h);
+        int c = k0 % block, tap = k0 / block % ksize, cb = k0 / (block*ksize);
+        for(int k = 0; k < kc;) {
+            int ih = oh*cols->stride - cols->pad + tap / cols->size, iw = ow*cols->stride - cols->pad + tap % cols->size;
+            int run = kc - k < block - c ? kc - k : block - c;
+            if(ih < 0 || ih >= cols->height || iw < 0 || iw >= cols->width) {
+                for(int j = 0; j < run; ++j) packed[(k + j)*width + r] = 0.f;
+            }
+            else {
+                const float* pixel = cols->im + b*s->batch + cb*s->channel_block + ih*s->row + iw*s->col + c;
+                for(int j = 0; j < run; ++j) packed[(k + j)*width + r] = pixel[j];
+            }
+            k += run, c = 0;
+            if(++tap == ksize) tap = 0, ++cb;
+        }
+    }
+    for(; r < width; ++r) {
+        for(int k = 0; k < kc; ++k) packed[k*width + r] = 0.f;
+    }
+}
+
+// The layouts other than NCHW convolve with implicit gemms of the columns and the filters, transposed
+// to the order of the columns. In NHWC the output is the (image, oh, ow) x filters matrix of a single
+// gemm over the whole batch. In the blocked layouts every image is a gemm with all the filters, whose
+// NHWC output is then split into the blocks, which is far cheaper than a narrow gemm per block.
+// 1x1 convolutions in NHWC need no packing at all
+static void conv_forward_blocked(scyte_node* node)
+{
+    scyte_node* x = node->children[0], *w = node->children[1];
+    int num_filters = w->shape[0];
+    int batch_size = x->shape[0], in_c = x->shape[1], in_h = x->shape[2], in_w = x->shape[3];
+    int out_h = node->shape[2], out_w = node->shape[3];
+    int* conv_params = (int*)node->params;
+    int size = conv_params[0], stride = conv_params[1], pad = conv_params[2];
+    int ksize = size*size, k = in_c*ksize, pixels = out_h*out_w;
+
+    if(x->layout == SCYTE_NHWC && is_pointwise(size, stride, pad)) {
+        gemm_cpu(0, 1, batch_size*pixels, num_filters, in_c, 1.f, x->vals, w->vals, 0.f, node->vals);
+        return;
+    }
+    blocked_columns cols = { x->vals, scyte_layout_get_strides(x->layout, x->shape), in_h, in_w, size, stride, pad, out_h, out_w };
+    int block = cols.strides.block;
+    float* packed = (float*)node->tmp;
+    for(int f = 0; f < num_filters; ++f) {
+        for(int c = 0; c < in_c; ++c) {
+            for(int tap = 0; tap < ksize; ++tap) {
+                packed[(((c / block)*ksize + tap)*block + c % block)*num_filters + f] = w->vals[(f*in_c + c)*ksize + tap];
+            }
+        }
+    }
+    if(x->layout == SCYTE_NHWC) {
+        gemm_matrix filters = { packed, 0, num_filters };
+        memset(node->vals, 0, (size_t)batch_size*num_filters*pixels*sizeof(float));
+        gemm_panels_cpu(batch_size*pixels, num_filters, k, 1.f, pack_blocked_columns, &cols, gemm_pack_cols, &filters, node->vals, num_filters);
+        return;
+    }
+    gemm_matrix filters = { packed, 0, num_filters };
+    float* image = packed + (size_t)k*num_filters;
+    int image_shape[4] = { 1, num_filters, out_h, out_w };
+    for(int b = 0; b < batch_size; ++b) {
+        cols.im = x->vals + b*cols.strides.batch;
+        memset(image, 0, (size_t)pixels*num_filters*sizeof(float));
+        gemm_panels_cpu(pixels, num_filters, k, 1.f, pack_blocked_columns, &cols, gemm_pack_cols, &filters, image, num_filters);
+        scyte_layout_copy(image_shape, image, SCYTE_NHWC, node->vals + (size_t)b*num_filters*pixels, node->layout, 0);
+    }
+}
+
+static void run_conv_forward(scyte_node* node, scyte_conv_algo algo)
+{
+    if(algo == SCYTE_CONV_DIRECT) conv_forward_direct(node);
+    else if(algo == SCYTE_CONV_WINOGRAD_2X2) conv_forward_winograd(node, &winograd2);
+    else if(algo == SCYTE_CONV_WINOGRAD_4X4) conv_forward_winograd(node, &winograd4);
+    else conv_forward_gemm(node);
+}
+
+// algorithms already selected, by input shape, number of filters, filter size, stride and padding
+typedef struct {
+    int key[7];
+    scyte_conv_algo algo;
+} conv_choice;
+
+static conv_choice* conv_choices;
+static int num_conv_choices;
+static pthread_mutex_t conv_choices_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int find_conv_choice(const int* key)
+{
+    for(int i = 0; i < num_conv_choices; ++i) {
+        if(memcmp(conv_choices[i].key, key, sizeof(conv_choices[i].key)) == 0) return conv_choices[i].algo;
+    }
+    return SCYTE_CONV_AUTO;
+}
+
+// times every algorithm that supports the node's shape on its current input, and caches the fastest
+static scyte_conv_algo select_conv_algo(scyte_node* node)
+{
+    scyte_node* x = node->children[0];
+    int* conv_params = (int*)node->params;
+    int key[7] = { x->shape[1], x->shape[2], x->shape[3], node->shape[1], conv_params[0], conv_params[1], conv_params[2] };
+    pthread_mutex_lock(&conv_choices_lock);
+    scyte_conv_algo best = find_conv_choice(key);
+    pthread_mutex_unlock(&conv_choices_lock);
+    if(best != SCYTE_CONV_AUTO) return best;
+
+    double best_time = DBL_MAX;
+    for(int algo = SCYTE_CONV_GEMM; algo <= SCYTE_CONV_WINOGRAD_4X4; ++algo) {
+        if(!scyte_conv_algo_supported(algo, conv_params[0], conv_params[1])) continue;
+        double elapsed = DBL_MAX;
+        for(int run = 0; run < 2; ++run) { // the first run also warms up the caches
+            double start = time_now();
+            run_conv_forward(node, algo);
+            double t = time_now() - start;
+            if(t < elapsed) elapsed = t;
+        }
+        if(elapsed < best_time) best_time = elapsed, best = algo;
+    }
+
+    pthread_mutex_lock(&conv_choices_lock);
+    if(find_conv_choice(key) == SCYTE_CONV_AUTO) {
+        conv_choices = (conv_choice*)realloc(conv_choices, (num_conv_choices + 1)*sizeof(conv_choice));
+        memcpy(conv_choices[num_conv_choices].key, key, sizeof(key));
+        conv_choices[num_conv_choices++].algo = best;
+    }
+    pthread_mutex_unlock(&conv_choices_lock);
+    return best;
+}
+
+const char* scyte_conv_algo_string(scyte_conv_algo algo)
+{
+    switch(algo) {
+        case SCYTE_CONV_AUTO: return "auto";
+        case SCYTE_CONV_GEMM: return "gemm";
+        case SCYTE_CONV_DIRECT: return "direct";
+        case SCYTE_CONV_WINOGRAD_2X2: return "winograd 2x2";
+        case SCYTE_CONV_WINOGRAD_4X4: return "winograd 4x4";
+    }
+    return "unknown";
+}
+
+int scyte_conv_algo_supported(scyte_conv_algo algo, int size, int stride)
+{
+    if(algo == SCYTE_CONV_WINOGRAD_2X2 || algo == SCYTE_CONV_WINOGRAD_4X4) return is_winograd(size, stride);
+    return algo >= SCYTE_CONV_AUTO && algo <= SCYTE_CONV_DIRECT;
+}
+
+scyte_conv_algo scyte_get_conv_algo(const scyte_node* node)
+{
+    // networks saved before the algorithm was part of the params select it again
+    if(node->params_size <= CONV_ALGO_PARAM*sizeof(int)) return SCYTE_CONV_AUTO;
+    return ((int*)node->params)[CONV_ALGO_PARAM];
+}
+
+// grows the params of networks saved with fewer of them
+static void reserve_conv_params(scyte_node* node)
+{
+    if(node->params_size >= NUM_CONV_PARAMS*sizeof(int)) return;
+    int num_params = node->params_size / sizeof(int);
+    int* conv_params = (int*)realloc(node->params, NUM_CONV_PARAMS*sizeof(int));
+    for(int i = num_params; i < NUM_CONV_PARAMS; ++i) conv_params[i] = 0;
+    node->params = conv_params;
+    node->params_size = NUM_CONV_PARAMS*sizeof(int);
+}
+
+int scyte_set_conv_algo(scyte_node* node, scyte_conv_algo algo)
+{
+    int* conv_params = (int*)node->params;
+    if(!scyte_conv_algo_supported(algo, conv_params[0], conv_params[1])) {
+        LOG_ERRORF("conv algorithm %s doesn't support %dx%d filters with stride %d",
+                scyte_conv_algo_string(algo), conv_params[0], conv_params[0], conv_params[1]);
+        return 0;
+    }
+    reserve_conv_params(node);
+    ((int*)node->params)[CONV_ALGO_PARAM] = algo;
+    return 1;
+}
+
+scyte_activation scyte_get_conv_activation(const scyte_node* node)
+{
+    if(node->params_size <= CONV_ACTIVATION_PARAM*sizeof(int)) return SCYTE_ACTIVATION_NONE;
+    return ((int*)node->params)[CONV_ACTIVATION_PARAM];
+}
+
+void scyte_set_conv_activation(scyte_node* node, scyte_activation act)
+{
+    reserve_conv_params(node);
+    ((int*)node->params)[CONV_ACTIVATION_PARAM] = act;
+}
+
+void scyte_conv2d_forward(scyte_node* node)
+{
+    conv_workspace(node);
+    if(node->children[0]->layout != SCYTE_NCHW) conv_forward_blocked(node);
+    else {
+        scyte_conv_algo algo = scyte_get_conv_algo(node);
+        if(algo == SCYTE_CONV_AUTO) {
+            algo = select_conv_algo(node);
+            scyte_set_conv_algo(node, algo);
+        }
+        run_conv_forward(node, algo);
+    }
+    scyte_activate(scyte_num_elements(node), scyte_get_conv_activation(node), node->vals);
+}
+
+// Implicit im2col of a batch of images for gemm_panels_cpu: row (c, ki, kj), column (image, oh, ow).
+// The filters may be rectangular and the padding negative, as for the phases of the transposed
+// convolution in conv_backward_data
+typedef struct {
+    const float* im;
+    int channels, height, width;
+    int size_h, size_w, stride, pad_h, pad_w;
+    int out_h, out_w;
+} conv_columns;
+
+static inline float column_pixel(const conv_columns* cols, int b, int c, int row, int col)
+{
+    if(row < 0 || col < 0 || row >= cols->height || col >= cols->width) return 0.f;
+    return cols->im[((b*cols->channels + c)*cols->height + row)*cols->width + col];
+}
+
+// packs columns first..first+n over the rows k0..k0+kc, see gemm_panel_fn. The columns are walked
+// in runs along the output rows, so the input row is only looked up once per run
+static void pack_columns(const void* ctx, int first, int k0, int n, int kc, int width, float* packed)
+{
+    const conv_columns* cols = (const conv_columns*)ctx;
+    int ksize = cols->size_h*cols->size_w, stride = cols->stride;
+    for(int k = 0; k < kc; ++k, packed += width) {
+        int row = k0 + k, c = row / ksize, ki = row % ksize / cols->size_w, kj = row % cols->size_w;
+        int ow = first % cols->out_w, oh = first / cols->out_w % cols->out_h, b = first / (cols->out_w*cols->out_h);
+        for(int r = 0; r < n;) {
+            int run = n - r < cols->out_w - ow ? n - r : cols->out_w - ow;
+            int ih = oh*stride - cols->pad_h + ki, iw = ow*stride - cols->pad_w + kj;
+            if(ih < 0 || ih >= cols->height) memset(packed + r, 0, run*sizeof(float));
+            else {
+                const float* src = cols->im + ((b*cols->channels + c)*cols->height + ih)*cols->width;
+                for(int j = 0; j < run; ++j, iw += stride) packed[r + j] = iw >= 0 && iw < cols->width ? src[iw] : 0.f;
+            }
+            r += run, ow += run;
+            if(ow == cols->out_w) {
+                ow = 0;
+                if(++oh == cols->out_h) oh = 0, ++b;
+            }
+        }
+        for(int r = n; r < width; ++r) packed[r] = 0.f;
+    }
+}
+
+// packs rows first..first+n of the transposed columns over the columns k0..k0+kc
+static void pack_columns_transposed(const void* ctx, int first, int k0, int n, int kc, int width, float* packed)
+{
+    const conv_columns* cols = (const conv_columns*)ctx;
+    int ksize = cols->size_h*cols->size_w;
+    int channel[GEMM_MAX_NR], row_offset[GEMM_MAX_NR], col_offset[GEMM_MAX_NR];
+    for(int r = 0; r < n; ++r) {
+        int row = first + r;
+        channel[r] = row / ksize;
+        row_offset[r] = row % ksize / cols->size_w - cols->pad_h;
+        col_offset[r] = row % cols->size_w - cols->pad_w;
+    }
+    int ow = k0 % cols->out_w, oh = k0 / cols->out_w % cols->out_h, b = k0 / (cols->out_w*cols->out_h);
+    for(int k = 0; k < kc; ++k, packed += width) {
+        int r;
+        for(r = 0; r < n; ++r) {
+            packed[r] = column_pixel(cols, b, channel[r], oh*cols->stride + row_offset[r], ow*cols->stride + col_offset[r]);
+        }
+        for(; r < width; ++r) packed[r] = 0.f;
+        if(++ow == cols->out_w) {
+            ow = 0;
+            if(++oh == cols->out_h) oh = 0, ++b;
+        }
+    }
+}
+
+// the output's gradient as a filters x (image, oh, ow) matrix
+typedef struct {
+    const float* delta;
+    int filters, n; // n = out_h*out_w
+} conv_deltas;
+
+static void pack_deltas(const void* ctx, int first, int k0, int n, int kc, int width, float* packed)
+{
+    const conv_deltas* d = (const conv_deltas*)ctx;
+    int b = k0 / d->n, p = k0 % d->n;
+    for(int k = 0; k < kc; ++k, packed += width) {
+        const float* delta = d->delta + (b*d->filters + first)*d->n + p;
+        int r;
+        for(r = 0; r < n; ++r) packed[r] = delta[r*d->n];
+        for(; r < width; ++r) packed[r] = 0.f;
+        if(++p == d->n) p = 0, ++b;
+    }
+}
+
+// Gradient of the filters, dW += dY*cols^T, as one implicit gemm over the whole batch. The columns
+// are packed panel by panel straight from the input, and the batch is part of the reduction, so
+// w->delta is only written once. The gemm spreads the filters over the threads, or if the images
+// are spread over the threads, every thread sums the gradient of its images in its own slice of the
+// workspace, and the slices are then added to w->delta
+static void conv_backward_filter(scyte_node* node, const float* im, const float* dy)
+{
+    scyte_node* x = node->children[0], *w = node->children[1];
+    int num_filters = w->shape[0];
+    int batch_size = x->shape[0], in_c = x->shape[1], in_h = x->shape[2], in_w = x->shape[3];
+    int out_h = node->shape[2], out_w = node->shape[3];
+    int* conv_params = (int*)node->params;
+    int size = conv_params[0], stride = conv_params[1], pad = conv_params[2];
+
+    int k = in_c*size*size, n = out_h*out_w, threads = conv_batch_threads(node);
+    conv_deltas d = { dy, num_filters, n };
+    conv_columns cols = { im, in_c, in_h, in_w, size, size, stride, pad, pad, out_h, out_w };
+    if(threads == 1) {
+        gemm_panels_cpu(num_filters, k, batch_size*n, 1.f, pack_deltas, &d, pack_columns_transposed, &cols, w->delta, k);
+        return;
+    }
+
+    float* partial = (float*)node->tmp;
+    int len = num_filters*k;
+    #pragma omp parallel for num_threads(threads)
+    for(int t = 0; t < threads; ++t) {
+        int first = t*batch_size / threads, last = (t + 1)*batch_size / threads;
+        conv_deltas dt = { dy + (size_t)first*num_filters*n, num_filters, n };
+        conv_columns ct = cols;
+        ct.im = im + (size_t)first*in_c*in_h*in_w;
+        memset(partial + (size_t)t*len, 0, len*sizeof(float));
+        gemm_panels_cpu(num_filters, k, (last - first)*n, 1.f, pack_deltas, &dt, pack_columns_transposed, &ct, partial + (size_t)t*len, k);
+    }
+    #pragma omp parallel for
+    for(int i = 0; i < len; ++i) {
+        float sum = 0.f;
+        for(int t = 0; t < threads; ++t) sum += partial[(size_t)t*len + i];
+        w->delta[i] += sum;
+    }
+}
+
+// The pixels ih of the input with (ih + pad) % stride == phase only receive gradient from the filter
+// rows ki = phase + a*stride. Over these pixels, ih = first + t*stride, the transposed convolution
+// is a plain stride 1 convolution of dY with the flipped rows of the filter
+typedef struct {
+    int first, count;   // first pixel of the phase, number of pixels
+    int size, pad;      // filter rows of the phase, padding of dY
+} conv_phase;
+
+static inline conv_phase make_conv_phase(int phase, int size, int stride, int pad, int in_size)
+{
+    conv_phase p;
+    p.first = ((phase - pad) % stride + stride) % stride;
+    p.count = in_size > p.first ? (in_size - p.first + stride - 1) / stride : 0;
+    p.size = phase < size ? (size - phase + stride - 1) / stride : 0;
+    p.pad = p.size - 1 - (p.first + pad - phase) / stride;
+    return p;
+}
+
+// Gradient of the input, accumulated into x->delta without col2im. Every phase of the transposed
+// convolution is one implicit gemm per image, with the flipped filter rows and columns of the phase
+// and the columns of dY. With stride 1 there is a single phase that writes x->delta in place,
+// otherwise every pixel of a phase is added once from a staging buffer, without overlaps. The images
+// are independent, so they can be spread over the threads with a staging buffer each
+static void conv_backward_data(scyte_node* node, const float* dy, float* dx)
+{
+    scyte_node* x = node->children[0], *w = node->children[1];
+    int num_filters = w->shape[0];
+    int batch_size = x->shape[0], in_c = x->shape[1], in_h = x->shape[2], in_w = x->shape[3];
+    int out_h = node->shape[2], out_w = node->shape[3];
+    int* conv_params = (int*)node->params;
+    int size = conv_params[0], stride = conv_params[1], pad = conv_params[2];
+
+    int threads = conv_batch_threads(node);
+    size_t staging_size = backward_staging_size(in_c, stride, in_h, in_w);
+    float* flipped = (float*)node->tmp, *staging_base = flipped + in_c*num_filters*size*size;
+    for(int py = 0; py < stride; ++py) {
+        conv_phase ph = make_conv_phase(py, size, stride, pad, in_h);
+        for(int px = 0; px < stride; ++px) {
+            conv_phase pw = make_conv_phase(px, size, stride, pad, in_w);
+            // filters smaller than the stride skip some pixels, they have no gradient
+            if(ph.count == 0 || pw.count == 0 || ph.size == 0 || pw.size == 0) continue;
+            int n = ph.count*pw.count, k = num_filters*ph.size*pw.size;
+            // in_c x (filter, a, b), the filter rows and columns of the phase in reverse order
+            for(int c = 0; c < in_c; ++c) {
+                for(int f = 0; f < num_filters; ++f) {
+                    for(int a = 0; a < ph.size; ++a) {
+                        for(int b = 0; b < pw.size; ++b) {
+                            int ki = py + (ph.size - 1 - a)*stride, kj = px + (pw.size - 1 - b)*stride;
+                            flipped[((c*num_filters + f)*ph.size + a)*pw.size + b] = w->vals[((f*in_c + c)*size + ki)*size + kj];
+                        }
+                    }
+                }
+            }
+            gemm_matrix m = { flipped, 0, k };
+            #pragma omp parallel for num_threads(threads) if(threads > 1)
+            for(int i = 0; i < batch_size; ++i) {
+                float* imd = dx + i*in_c*in_h*in_w;
+                conv_columns cols = { dy + i*num_filters*out_h*out_w, num_filters, out_h, out_w,
+                        ph.size, pw.size, 1, ph.pad, pw.pad, ph.count, pw.count };
+                if(stride == 1) {
+                    gemm_panels_cpu(in_c, n, k, 1.f, gemm_pack_rows, &m, pack_columns, &cols, imd, n);
+                    continue;
+                }
+                float* staging = staging_base + conv_thread_num(threads)*staging_size;
+                memset(staging, 0, in_c*n*sizeof(float));
+                gemm_panels_cpu(in_c, n, k, 1.f, gemm_pack_rows, &m, pack_columns, &cols, staging, n);
+                for(int c = 0; c < in_c; ++c) {
+                    for(int t = 0; t < ph.count; ++t) {
+                        float* row = imd + (c*in_h + ph.first + t*stride)*in_w + pw.first;
+                        const float* src = staging + (c*ph.count + t)*pw.count;
+                        for(int u = 0; u < pw.count; ++u) row[u*stride] += src[u];
+                    }
+                }
+            }
+        }
+    }
+}
+
+void scyte_conv2d_backward(scyte_node* node)
+{
+    scyte_node* x = node->children[0], *w = node->children[1];
+    conv_workspace(node);
+    // the delta is only read by this node, so it's turned into the gradient before the activation in place
+    scyte_activation_gradient(scyte_num_elements(node), scyte_get_conv_activation(node), node->vals, node->delta);
+    if(x->layout == SCYTE_NCHW) {
+        if(scyte_has_gradient(w)) conv_backward_filter(node, x->vals, node->delta);
+        if(scyte_has_gradient(x)) conv_backward_data(node, node->delta, x->delta);
+        return;
+    }
+    // the gradients of the other layouts are computed in NCHW, on copies past the workspace the
+    // backward passes use. the input is copied there for the filters, and then reused for its gradient
+    int chunk;
+    size_t in_size = scyte_num_elements(x);
+    float* dy = (float*)node->tmp + algo_workspace(node, &chunk), *im = dy + scyte_num_elements(node);
+    scyte_layout_copy(node->shape, node->delta, node->layout, dy, SCYTE_NCHW, 0);
+    if(scyte_has_gradient(w)) {
+        scyte_layout_copy(x->shape, x->vals, x->layout, im, SCYTE_NCHW, 0);
+        conv_backward_filter(node, im, dy);
+    }
+    if(scyte_has_gradient(x)) {
+        memset(im, 0, in_size*sizeof(float));
+        conv_backward_data(node, dy, im);
+        scyte_layout_copy(x->shape, im, SCYTE_NCHW, x->delta, x->layout, 1);
+    }
 }
@@ -1,7 +1,7 @@
 #include "ops/dropout.h"
 
 #include "op.h"
-#include "utils.h"
+#include "random.h"
 
 #include <stdlib.h>
 #include <assert.h>
@@ -11,7 +11,7 @@ int scyte_dropout_sync_dims(scyte_node* node)
     scyte_copy_shape(node->children[0], node);
     // allocate space to store which elements were kept
     int n = scyte_num_elements(node->children[0]);
-    node->tmp = realloc(node->tmp, n);
+    node->tmp = realloc(node->tmp, n*sizeof(int));
     return 1;
 }
 
@@ -34,8 +34,9 @@ void scyte_dropout_forward(scyte_node* node)
     int* keep_elements = (int*)node->tmp;
     float dropout_rate = scyte_is_const(operand) || scyte_is_var(operand)? 0.f : *node->children[1]->vals;
     float scale = 1.f / (1.f - dropout_rate);
+    scyte_rng* rng = scyte_thread_rng(); // replicas run dropout concurrently
     for(int i = 0; i < n; ++i) {
-        int keep = random_uniform(0.f, 1.f) >= dropout_rate;
+        int keep = scyte_rng_uniform(rng, 0.f, 1.f) >= dropout_rate;
         node->vals[i] = keep ? operand->vals[i]*scale : 0.f; // scale by s to keep expected value
         if(keep_elements != NULL) keep_elements[i] = keep;
     }
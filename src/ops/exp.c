@@ -33,7 +33,7 @@ void scyte_exp_backward(scyte_node* node)
     int n = scyte_num_elements(operand);
     if(scyte_has_gradient(operand)) {
         for(int i = 0; i < n; ++i) {
-            operand->delta[i] += node->delta[i]*operand->vals[i];
+            operand->delta[i] += node->delta[i]*node->vals[i];
         }
     }
 }
@@ -0,0 +1,230 @@
+#include "ops/fused_elementwise.h"
+
+#include "blas.h"
+#include "logger.h"
+#include "op.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// elements per chunk, all registers of a chunk fit in the L1 cache
+#define FUSED_CHUNK 128
+
+typedef struct {
+    int op, a, b;
+} fused_instr;
+
+static inline int get_num_instrs(const scyte_node* node)
+{
+    return ((int*)node->params)[0];
+}
+
+static inline const fused_instr* get_program(const scyte_node* node)
+{
+    return (const fused_instr*)((int*)node->params + 1);
+}
+
+const int* scyte_fused_elementwise_program(const scyte_node* node, int* num_instrs)
+{
+    *num_instrs = get_num_instrs(node);
+    return (const int*)get_program(node);
+}
+
+int scyte_fused_elementwise_sync_dims(scyte_node* node)
+{
+    // the output has the shape of the largest input
+    scyte_node* largest = node->children[0];
+    for(int i = 1; i < node->num_children; ++i) {
+        if(scyte_num_elements(node->children[i]) > scyte_num_elements(largest)) largest = node->children[i];
+    }
+    int n = scyte_num_elements(largest);
+    for(int i = 0; i < node->num_children; ++i) {
+        if(n % scyte_num_elements(node->children[i]) != 0) {
+            LOG_ERRORF("dimensions (%d %% %d != 0) of input %d were not properly synced", n, scyte_num_elements(node->children[i]), i);
+            return 0;
+        }
+    }
+    int num_instrs = get_num_instrs(node), num_regs = node->num_children + num_instrs;
+    if(num_instrs < 1 || num_regs > SCYTE_FUSED_MAX_REGS) {
+        LOG_ERRORF("can't fuse %d instructions of %d inputs", num_instrs, node->num_children);
+        return 0;
+    }
+    const fused_instr* program = get_program(node);
+    for(int k = 0; k < num_instrs; ++k) {
+        int reg = node->num_children + k;
+        if(program[k].a < 0 || program[k].a >= reg || program[k].b < 0 || program[k].b >= reg) {
+            LOG_ERRORF("instruction %d reads a register that isn't set yet", k);
+            return 0;
+        }
+    }
+    scyte_copy_shape(largest, node);
+    return 1;
+}
+
+scyte_node* scyte_fused_elementwise(int n, scyte_node** inputs, int num_instrs, const int* program)
+{
+    scyte_node* node = make_opn_node(FUSED_ELEMENTWISE, n, inputs);
+    node->forward = scyte_fused_elementwise_forward, node->backward = scyte_fused_elementwise_backward;
+    int* params = (int*)malloc((1 + 3*num_instrs)*sizeof(int));
+    params[0] = num_instrs;
+    memcpy(params + 1, program, 3*num_instrs*sizeof(int));
+    node->params = params;
+    node->params_size = (1 + 3*num_instrs)*sizeof(int);
+    if(!scyte_fused_elementwise_sync_dims(node)) {
+        free_op_node(node);
+        return NULL;
+    }
+    return node;
+}
+
+static void run_instr(int op, const float* a, const float* b, float* y, int n)
+{
+    switch(op) {
+        case ADD: for(int i = 0; i < n; ++i) y[i] = a[i] + b[i]; break;
+        case SUB: for(int i = 0; i < n; ++i) y[i] = a[i] - b[i]; break;
+        case MULTIPLY: for(int i = 0; i < n; ++i) y[i] = a[i]*b[i]; break;
+        case SQUARE: for(int i = 0; i < n; ++i) y[i] = a[i]*a[i]; break;
+        case EXP: exp_cpu(n, a, y); break;
+        case SIGMOID: sigmoid_cpu(n, a, y); break;
+        case TANH: tanh_cpu(n, a, y); break;
+        case RELU: for(int i = 0; i < n; ++i) y[i] = a[i]*(a[i] > 0.f); break;
+        default: break;
+    }
+}
+
+// accumulates the gradients of the operands of y = op(a, b) given the gradient g of y
+static void backprop_instr(int op, const float* a, const float* b, const float* y, const float* g, float* ga, float* gb, int n)
+{
+    switch(op) {
+        case ADD:
+            for(int i = 0; i < n; ++i) ga[i] += g[i];
+            for(int i = 0; i < n; ++i) gb[i] += g[i];
+            break;
+        case SUB:
+            for(int i = 0; i < n; ++i) ga[i] += g[i];
+            for(int i = 0; i < n; ++i) gb[i] -= g[i];
+            break;
+        case MULTIPLY:
+            for(int i = 0; i < n; ++i) ga[i] += g[i]*b[i];
+            for(int i = 0; i < n; ++i) gb[i] += g[i]*a[i];
+            break;
+        case SQUARE: for(int i = 0; i < n; ++i) ga[i] += 2.f*a[i]*g[i]; break;
+        case EXP: for(int i = 0; i < n; ++i) ga[i] += g[i]*y[i]; break;
+        case SIGMOID: for(int i = 0; i < n; ++i) ga[i] += g[i]*y[i]*(1.f - y[i]); break;
+        case TANH: for(int i = 0; i < n; ++i) ga[i] += g[i]*(1.f - y[i]*y[i]); break;
+        case RELU: for(int i = 0; i < n; ++i) ga[i] += g[i]*(a[i] > 0.f); break;
+        default: break;
+    }
+}
+
+// Points the registers of the inputs at the chunk [first, first + n), the inputs smaller than the
+// output are repeated into their register's buffer, and strided inputs gathered into it. Then runs
+// the first num_instrs instructions
+static void run_chunk(const scyte_node* node, int size, int first, int n, int num_instrs,
+        float buffers[][FUSED_CHUNK], const float** regs)
+{
+    const fused_instr* program = get_program(node);
+    int num_inputs = node->num_children;
+    for(int i = 0; i < num_inputs; ++i) {
+        scyte_node* x = node->children[i];
+        int x_size = scyte_num_elements(x);
+        if(x_size == size && scyte_is_contiguous(x)) {
+            regs[i] = x->vals + first;
+            continue;
+        }
+        if(scyte_is_contiguous(x)) {
+            for(int k = 0, j = first % x_size; k < n; ++k) {
+                buffers[i][k] = x->vals[j];
+                if(++j == x_size) j = 0;
+            }
+        }
+        else {
+            // strided views are gathered in runs of consecutive elements
+            int strides[SCYTE_MAX_DIMS];
+            scyte_get_strides(x, strides);
+            for(int k = 0, j = first % x_size; k < n;) {
+                int len = x_size - j < n - k ? x_size - j : n - k;
+                scyte_gather_strided(x, strides, x->vals, j, len, buffers[i] + k);
+                k += len, j = 0;
+            }
+        }
+        regs[i] = buffers[i];
+    }
+    for(int k = 0; k < num_instrs; ++k) {
+        run_instr(program[k].op, regs[program[k].a], regs[program[k].b], buffers[num_inputs + k], n);
+        regs[num_inputs + k] = buffers[num_inputs + k];
+    }
+}
+
+void scyte_fused_elementwise_forward(scyte_node* node)
+{
+    int size = scyte_num_elements(node), num_instrs = get_num_instrs(node);
+    const fused_instr* last = get_program(node) + num_instrs - 1;
+    #pragma omp parallel for
+    for(int first = 0; first < size; first += FUSED_CHUNK) {
+        float buffers[SCYTE_FUSED_MAX_REGS][FUSED_CHUNK];
+        const float* regs[SCYTE_FUSED_MAX_REGS];
+        int n = size - first < FUSED_CHUNK ? size - first : FUSED_CHUNK;
+        // the output is written straight into the node's values
+        run_chunk(node, size, first, n, num_instrs - 1, buffers, regs);
+        run_instr(last->op, regs[last->a], regs[last->b], node->vals + first, n);
+    }
+}
+
+// the gradients of repeated inputs are summed over all chunks, so those can't run in parallel
+static inline int has_repeated_gradient(const scyte_node* node)
+{
+    for(int i = 0; i < node->num_children; ++i) {
+        scyte_node* x = node->children[i];
+        if(scyte_has_gradient(x) && scyte_num_elements(x) != scyte_num_elements((scyte_node*)node)) return 1;
+    }
+    return 0;
+}
+
+void scyte_fused_elementwise_backward(scyte_node* node)
+{
+    int size = scyte_num_elements(node), num_instrs = get_num_instrs(node), num_inputs = node->num_children;
+    int num_regs = num_inputs + num_instrs;
+    const fused_instr* program = get_program(node);
+
+    #pragma omp parallel for if(!has_repeated_gradient(node))
+    for(int first = 0; first < size; first += FUSED_CHUNK) {
+        float buffers[SCYTE_FUSED_MAX_REGS][FUSED_CHUNK], grads[SCYTE_FUSED_MAX_REGS][FUSED_CHUNK];
+        const float* regs[SCYTE_FUSED_MAX_REGS];
+        int n = size - first < FUSED_CHUNK ? size - first : FUSED_CHUNK;
+        // the intermediate results are recomputed, the output is the node's values
+        run_chunk(node, size, first, n, num_instrs - 1, buffers, regs);
+        regs[num_regs - 1] = node->vals + first;
+        for(int r = 0; r < num_regs - 1; ++r) memset(grads[r], 0, n*sizeof(float));
+
+        for(int k = num_instrs - 1; k >= 0; --k) {
+            const fused_instr* instr = &program[k];
+            const float* g = k == num_instrs - 1 ? node->delta + first : grads[num_inputs + k];
+            backprop_instr(instr->op, regs[instr->a], regs[instr->b], regs[num_inputs + k], g, grads[instr->a], grads[instr->b], n);
+        }
+        for(int i = 0; i < num_inputs; ++i) {
+            scyte_node* x = node->children[i];
+            if(!scyte_has_gradient(x)) continue;
+            int x_size = scyte_num_elements(x);
+            if(x_size == size && scyte_is_contiguous(x)) {
+                axpy_cpu(n, 1.f, grads[i], x->delta + first);
+                continue;
+            }
+            if(scyte_is_contiguous(x)) {
+                for(int k = 0, j = first % x_size; k < n; ++k) {
+                    x->delta[j] += grads[i][k];
+                    if(++j == x_size) j = 0;
+                }
+                continue;
+            }
+            int strides[SCYTE_MAX_DIMS];
+            scyte_get_strides(x, strides);
+            for(int k = 0, j = first % x_size; k < n;) {
+                int len = x_size - j < n - k ? x_size - j : n - k;
+                scyte_scatter_add_strided(x, strides, grads[i] + k, j, len, x->delta);
+                k += len, j = 0;
+            }
+        }
+    }
+}
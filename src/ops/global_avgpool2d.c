@@ -0,0 +1,46 @@
+#include "ops/global_avgpool2d.h"
+
+#include "pool.h"
+#include "op.h"
+#include "logger.h"
+
+// a single window over the whole plane
+static inline scyte_pool get_pool(const scyte_node* node)
+{
+    scyte_node* x = node->children[0];
+    scyte_pool pool = { SCYTE_POOL_AVG, x->shape[2], x->shape[3], 1, 0 };
+    return pool;
+}
+
+int scyte_global_avgpool2d_sync_dims(scyte_node* node)
+{
+    if(node->children[0]->num_dims != 4) {
+        LOG_ERRORF("x has %d dimension(s), it must have shape NCHW", node->children[0]->num_dims);
+        return 0;
+    }
+    scyte_pool pool = get_pool(node);
+    return scyte_pool_sync_dims(&pool, node->children[0], node);
+}
+
+scyte_node* scyte_global_avgpool2d(scyte_node* x)
+{
+    scyte_node* node = make_op1_node(GLOBAL_AVGPOOL2D, x);
+    node->forward = scyte_global_avgpool2d_forward, node->backward = scyte_global_avgpool2d_backward;
+    if(!scyte_global_avgpool2d_sync_dims(node)) {
+        free_op_node(node);
+        return NULL;
+    }
+    return node;
+}
+
+void scyte_global_avgpool2d_forward(scyte_node* node)
+{
+    scyte_pool pool = get_pool(node);
+    scyte_pool_forward(&pool, node->children[0], node, NULL);
+}
+
+void scyte_global_avgpool2d_backward(scyte_node* node)
+{
+    scyte_pool pool = get_pool(node);
+    scyte_pool_backward(&pool, node->children[0], node, NULL);
+}
@@ -0,0 +1,51 @@
+#include "ops/layout_transform.h"
+
+#include "layout.h"
+#include "logger.h"
+#include "op.h"
+
+#include <stdlib.h>
+
+int scyte_layout_transform_sync_dims(scyte_node* node)
+{
+    scyte_node* x = node->children[0];
+    scyte_layout layout = *(int*)node->params;
+    if(x->num_dims != 4) {
+        LOG_ERRORF("x has %d dimension(s), only 4-d tensors have a layout", x->num_dims);
+        return 0;
+    }
+    if(!scyte_layout_supported(layout, x->shape[1])) {
+        LOG_ERRORF("%d channels can't be stored in layout %s", x->shape[1], scyte_layout_string(layout));
+        return 0;
+    }
+    scyte_copy_shape(x, node);
+    node->layout = layout;
+    return 1;
+}
+
+scyte_node* scyte_layout_transform(scyte_node* x, scyte_layout layout)
+{
+    scyte_node* node = make_op1_node(LAYOUT_TRANSFORM, x);
+    node->forward = scyte_layout_transform_forward, node->backward = scyte_layout_transform_backward;
+    int* layout_param = (int*)calloc(1, sizeof(int));
+    *layout_param = layout;
+    node->params = layout_param;
+    node->params_size = sizeof(int);
+    if(!scyte_layout_transform_sync_dims(node)) {
+        free_op_node(node);
+        return NULL;
+    }
+    return node;
+}
+
+void scyte_layout_transform_forward(scyte_node* node)
+{
+    scyte_node* x = node->children[0];
+    scyte_layout_copy(node->shape, x->vals, x->layout, node->vals, node->layout, 0);
+}
+
+void scyte_layout_transform_backward(scyte_node* node)
+{
+    scyte_node* x = node->children[0];
+    if(scyte_has_gradient(x)) scyte_layout_copy(node->shape, node->delta, node->layout, x->delta, x->layout, 1);
+}
@@ -26,9 +26,7 @@ void scyte_log_forward(scyte_node* node)
 {
     scyte_node* operand = node->children[0];
     int n = scyte_num_elements(operand);
-    for(int i = 0; i < n; ++i) {
-        node->vals[i] = logf(operand->vals[i]);
-    }
+    log_cpu(n, operand->vals, node->vals);
 }
 
 void scyte_log_backward(scyte_node* node)
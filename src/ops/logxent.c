@@ -9,6 +9,8 @@
 #include <stdio.h>
 
 #define EPS 1e-9
+// elements whose logs are computed at once
+#define LOGXENT_CHUNK 256
 
 int scyte_logistic_x_entropy_sync_dims(scyte_node* node)
 {
@@ -37,11 +39,15 @@ void scyte_logistic_x_entropy_forward(scyte_node* node)
 {
     scyte_node* pred = node->children[0], *truth = node->children[1];
     int n = scyte_num_elements(pred);
-    float cost = 0.f;
-    for(int i = 0; i < n; ++i) {
-        float p = pred->vals[i];
-        float t = truth->vals[i];
-        cost += -t*logf(p + EPS) - (1-t)*logf(1-p + EPS);
+    float cost = 0.f, logs[2][LOGXENT_CHUNK];
+    for(int first = 0; first < n; first += LOGXENT_CHUNK) {
+        int m = n - first < LOGXENT_CHUNK ? n - first : LOGXENT_CHUNK;
+        const float* p = pred->vals + first, *t = truth->vals + first;
+        bias_cpu(m, EPS, p, logs[0]);
+        for(int i = 0; i < m; ++i) logs[1][i] = 1.f - p[i] + EPS;
+        log_cpu(m, logs[0], logs[0]);
+        log_cpu(m, logs[1], logs[1]);
+        for(int i = 0; i < m; ++i) cost += -t[i]*logs[0][i] - (1.f - t[i])*logs[1][i];
     }
     node->vals[0] = cost / (float)n;
 }
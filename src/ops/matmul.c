@@ -39,6 +39,12 @@ scyte_node* scyte_matmul(scyte_node* x, scyte_node* y)
     return node;
 }
 
+int scyte_matmul_reads_strided(const scyte_node* node, int i)
+{
+    // the rows of a matrix are its first axis, so a transposed one must be 2-d
+    return scyte_matrix_trans(node->children[i]) >= 0;
+}
+
 void scyte_matmul_forward(scyte_node* node)
 {
     scyte_node* x = node->children[0], *y = node->children[1];
@@ -48,7 +54,7 @@ void scyte_matmul_forward(scyte_node* node)
 
     set_cpu(num_rows_x*num_cols_y, 0.f, node->vals);
     if(x->vals != NULL && y->vals != NULL) {
-        gemm_cpu(0, 0, num_rows_x, num_cols_y, num_cols_x,
+        gemm_cpu(scyte_matrix_trans(x), scyte_matrix_trans(y), num_rows_x, num_cols_y, num_cols_x,
                 1.f, x->vals, y->vals, 1.f, node->vals);
     }
 }
@@ -60,12 +66,14 @@ void scyte_matmul_backward(scyte_node* node)
     get_rows_cols(x, &num_rows_x, &num_cols_x);
     get_rows_cols(y, &num_rows_y, &num_cols_y);
 
+    // transposed inputs take their gradient transposed
+    int trans_x = scyte_matrix_trans(x), trans_y = scyte_matrix_trans(y);
     if(scyte_has_gradient(x) && y->vals != NULL) {
-        gemm_cpu(0, 1, num_rows_x, num_cols_x, num_cols_y,
-                1.f, node->delta, y->vals, 1.f, x->delta);
+        gemm_acc_cpu(0, !trans_y, trans_x, num_rows_x, num_cols_x, num_cols_y,
+                1.f, node->delta, y->vals, x->delta);
     }
     if(scyte_has_gradient(y) && x->vals != NULL) {
-        gemm_cpu(1, 0, num_rows_y, num_cols_y, num_rows_x,
-                1.f, x->vals, node->delta, 1.f, y->delta);
+        gemm_acc_cpu(!trans_x, 0, trans_y, num_rows_y, num_cols_y, num_rows_x,
+                1.f, x->vals, node->delta, y->delta);
     }
 }
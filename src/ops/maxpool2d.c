@@ -1,35 +1,48 @@
 #include "ops/maxpool2d.h"
 
+#include "pool.h"
 #include "op.h"
 #include "logger.h"
 
 #include <stdlib.h>
-#include <float.h>
 
-int scyte_maxpool2d_sync_dims(scyte_node* node)
+#define NUM_MAXPOOL_PARAMS 4
+
+static inline scyte_pool get_pool(const scyte_node* node)
 {
-    scyte_node* x = node->children[0];
-    int n = x->shape[0], c = x->shape[1], h = x->shape[2], w = x->shape[3];
     int* pool_params = (int*)node->params;
-    int size = pool_params[0], stride = pool_params[1], padding = pool_params[2];
-    node->num_dims = 4;
-    node->shape[0] = n;
-    node->shape[1] = c;
-    node->shape[2] = (h + padding - size)/stride + 1;
-    node->shape[3] = (w + padding - size)/stride + 1;
+    scyte_pool pool = { SCYTE_POOL_MAX, pool_params[0], pool_params[0], pool_params[1], pool_params[2] };
+    return pool;
+}
 
-    // tmp will store the max indexes, for use in backward propagation
-    node->tmp = realloc(node->tmp, scyte_num_elements(node)*sizeof(int));
+int scyte_maxpool2d_recomputes(const scyte_node* node)
+{
+    // networks saved before the option was part of the params store the indexes
+    if(node->params_size < NUM_MAXPOOL_PARAMS*sizeof(int)) return 0;
+    return ((int*)node->params)[3];
+}
 
+int scyte_maxpool2d_sync_dims(scyte_node* node)
+{
+    scyte_pool pool = get_pool(node);
+    if(!scyte_pool_sync_dims(&pool, node->children[0], node)) return 0;
+
+    // tmp will store the max indexes, for use in backward propagation
+    if(scyte_maxpool2d_recomputes(node)) {
+        free(node->tmp);
+        node->tmp = NULL;
+    } else {
+        node->tmp = realloc(node->tmp, scyte_num_elements(node)*sizeof(int));
+    }
     return 1;
 }
 
 static inline void set_pool_params(scyte_node* node, int size, int stride, int padding)
 {
-    int* pool_params = (int*)calloc(3, sizeof(int));
+    int* pool_params = (int*)calloc(NUM_MAXPOOL_PARAMS, sizeof(int));
     pool_params[0] = size, pool_params[1] = stride, pool_params[2] = padding;
     node->params = pool_params;
-    node->params_size = 3*sizeof(int);
+    node->params_size = NUM_MAXPOOL_PARAMS*sizeof(int);
 }
 
 scyte_node* scyte_maxpool2d(scyte_node* x, int size, int stride, int padding)
@@ -49,47 +62,27 @@ scyte_node* scyte_maxpool2d(scyte_node* x, int size, int stride, int padding)
     return node;
 }
 
-void scyte_maxpool2d_forward(scyte_node* node)
+void scyte_set_maxpool2d_recompute(scyte_node* node, int recompute)
 {
-    scyte_node* x = node->children[0];
-    int in_h = node->shape[2], in_w = node->shape[3];
-
-    int batch = node->shape[0], c = node->shape[1], h = node->shape[2], w = node->shape[3];
-    if(!node->tmp) node->tmp = (int*)calloc(scyte_num_elements(node), sizeof(int));
-    int* indexes = (int*)node->tmp;
-    int* pool_params = (int*)node->params;
-    int size = pool_params[0], stride = pool_params[1], padding = pool_params[2];
-    int w_offset = -padding / 2.f, h_offset = -padding / 2.f;
-
-    for(int b = 0; b < batch; ++b) {
-        for(int k = 0; k < c; ++k) {
-            for(int i = 0; i < h; ++i) {
-                for(int j = 0; j < w; ++j) {
-                    int out_idx = j + w*(i + h*(k + c*b)), max_idx = -1;
-                    float max_val = -FLT_MAX;
-                    for(int n = 0; n < size; ++n) {
-                        for(int m = 0; m < size; ++m) {
-                            int cur_y = h_offset + i*stride + n, cur_x = w_offset + j*stride + m;
-                            int idx = cur_x + in_w*(cur_y + in_h*(k + b*c));
-                            int is_valid = (cur_y >= 0 && cur_y < in_h && cur_x >= 0 && cur_x < in_w);
-                            float val = is_valid ? x->vals[idx] : -FLT_MAX;
-                            if(val > max_val) max_idx = idx, max_val = val;
-                        }
-                    }
-                    node->vals[out_idx] = max_val;
-                    indexes[out_idx] = max_idx;
-                }
-            }
-        }
+    if(node->params_size < NUM_MAXPOOL_PARAMS*sizeof(int)) {
+        node->params = realloc(node->params, NUM_MAXPOOL_PARAMS*sizeof(int));
+        node->params_size = NUM_MAXPOOL_PARAMS*sizeof(int);
     }
+    ((int*)node->params)[3] = recompute;
+    scyte_maxpool2d_sync_dims(node);
+}
+
+// the index of the max of a window is its offset in x, so the backward pass doesn't depend on the layout
+void scyte_maxpool2d_forward(scyte_node* node)
+{
+    scyte_pool pool = get_pool(node);
+    int recompute = scyte_maxpool2d_recomputes(node);
+    if(!recompute && !node->tmp) node->tmp = (int*)calloc(scyte_num_elements(node), sizeof(int));
+    scyte_pool_forward(&pool, node->children[0], node, recompute ? NULL : (int*)node->tmp);
 }
 
 void scyte_maxpool2d_backward(scyte_node* node)
 {
-    scyte_node* x = node->children[0];
-    int n = scyte_num_elements(node), *indexes = (int*)node->tmp;
-    for(int i = 0; i < n; ++i) {
-        int idx = indexes[i];
-        x->delta[idx] += node->delta[i];
-    }
+    scyte_pool pool = get_pool(node);
+    scyte_pool_backward(&pool, node->children[0], node, scyte_maxpool2d_recomputes(node) ? NULL : (int*)node->tmp);
 }
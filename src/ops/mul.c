@@ -1,22 +1,11 @@
 #include "ops/mul.h"
 
-#include "blas.h"
+#include "broadcast.h"
 #include "op.h"
-#include "logger.h"
-
-#include <assert.h>
-#include <stdio.h>
 
 int scyte_mul_sync_dims(scyte_node* node)
 {
-    int n0 = scyte_num_elements(node->children[0]);
-    int n1 = scyte_num_elements(node->children[1]);
-    if(n0 % n1 != 0) {
-        LOG_ERRORF("dimensions (%d %% %d != 0) were not properly synced, returning NULL\n", n0, n1);
-        return 0;
-    }
-    scyte_copy_shape(node->children[0], node);
-    return 1;
+    return scyte_broadcast_sync_dims(node);
 }
 
 scyte_node* scyte_mul(scyte_node* x, scyte_node* y)
@@ -32,29 +21,13 @@ scyte_node* scyte_mul(scyte_node* x, scyte_node* y)
 
 void scyte_mul_forward(scyte_node* node)
 {
-    scyte_node* operands[2] = { node->children[0], node->children[1] };
-    int n0 = scyte_num_elements(operands[0]), n1 = scyte_num_elements(operands[1]);
-    assert(n0 >= n1);
-    if(n1 == 1) scale_cpu(n0, operands[1]->vals[0], operands[0]->vals, node->vals);
-    else {
-        for(int i = 0; i < n0; i += n1) {
-            mul_cpu(n1, operands[0]->vals + i, operands[1]->vals, node->vals + i);
-        }
-    }
+    scyte_broadcast_forward(node);
 }
 
 void scyte_mul_backward(scyte_node* node)
 {
-    scyte_node* operands[2] = { node->children[0], node->children[1] };
-    int n0 = scyte_num_elements(operands[0]), n1 = scyte_num_elements(operands[1]);
-    if(scyte_has_gradient(operands[0]) && operands[1]->vals != NULL) {
-        for(int i = 0; i < n0; i += n1) {
-            mul_sum_cpu(n1, node->delta + i, operands[1]->vals, operands[0]->delta + i);
-        }
-    }
-    if(scyte_has_gradient(operands[1]) && operands[0]->vals != NULL) {
-        for(int i = 0; i < n0; i += n1) {
-            mul_sum_cpu(n1, node->delta + i, operands[0]->vals + i, operands[1]->delta);
-        }
+    // the gradient of each operand is the other one's values
+    for(int i = 0; i < 2; ++i) {
+        if(scyte_has_gradient(node->children[i]) && node->children[1 - i]->vals != NULL) scyte_broadcast_backward(node, i);
     }
 }
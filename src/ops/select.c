@@ -65,16 +65,30 @@ scyte_node* scyte_dynamic_select(int n, scyte_node** nodes)
     return node;
 }
 
+int scyte_select_is_view(const scyte_node* node)
+{
+    // the chosen child's delta stands in for the select's, so it must have one whenever the select does
+    for(int i = 0; i < node->num_children; ++i) {
+        if(!scyte_has_gradient(node->children[i]) != !scyte_has_gradient(node)) return 0;
+    }
+    return 1;
+}
+
 void scyte_select_forward(scyte_node* node)
 {
     int node_idx = get_node_idx(node);
     scyte_node* chosen_node = node->children[node_idx];
+    if(scyte_select_is_view(node)) {
+        node->vals = chosen_node->vals, node->delta = chosen_node->delta;
+        return;
+    }
     int n = scyte_num_elements(chosen_node);
     copy_cpu(n, chosen_node->vals, node->vals);
 }
 
 void scyte_select_backward(scyte_node* node)
 {
+    if(scyte_select_is_view(node)) return;
     int node_idx = get_node_idx(node);
     scyte_node* chosen_node = node->children[node_idx];
     int n = scyte_num_elements(chosen_node);
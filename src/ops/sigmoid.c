@@ -23,16 +23,12 @@ scyte_node* scyte_sigmoid(scyte_node* x)
     return node;
 }
 
-#define sigmoid(x) 0.5f*tanhf(0.5f*x) + 0.5f
 void scyte_sigmoid_forward(scyte_node* node)
 {
     scyte_node* operand = node->children[0];
     int n = scyte_num_elements(operand);
-    for(int i = 0; i < n; ++i) {
-        node->vals[i] = sigmoid(operand->vals[i]);
-    }
+    sigmoid_cpu(n, operand->vals, node->vals);
 }
-#undef sigmoid
 
 void scyte_sigmoid_backward(scyte_node* node)
 {
@@ -0,0 +1,63 @@
+#include "ops/sigmoid_xent.h"
+
+#include "blas.h"
+#include "logger.h"
+#include "op.h"
+
+// elements whose logs are computed at once
+#define SIGMOID_XENT_CHUNK 256
+
+int scyte_sigmoid_x_entropy_sync_dims(scyte_node* node)
+{
+    int n0 = scyte_num_elements(node->children[0]);
+    int n1 = scyte_num_elements(node->children[1]);
+    if(n0 != n1) {
+        LOG_ERRORF("dimensions (%d != %d) were not equal, returning NULL\n", n0, n1);
+        return 0;
+    }
+    node->num_dims = 0;
+    return 1;
+}
+
+scyte_node* scyte_sigmoid_x_entropy(scyte_node* truth, scyte_node* pred)
+{
+    if(scyte_is_operand(pred) || pred->op_type != SIGMOID) {
+        LOG_ERROR("the prediction isn't a sigmoid, returning NULL");
+        return NULL;
+    }
+    scyte_node* children[] = { pred->children[0], truth, pred };
+    scyte_node* node = make_opn_node(SIGMOID_XENT, 3, children);
+    node->forward = scyte_sigmoid_x_entropy_forward, node->backward = scyte_sigmoid_x_entropy_backward;
+    if(!scyte_sigmoid_x_entropy_sync_dims(node)) {
+        free_op_node(node);
+        return NULL;
+    }
+    return node;
+}
+
+// -t*log(p) - (1-t)*log(1-p) = max(x, 0) - x*t + log(1 + exp(-|x|)), where the last term is
+// -log(max(p, 1-p)), the log of a number in [0.5, 1] whatever x is
+void scyte_sigmoid_x_entropy_forward(scyte_node* node)
+{
+    scyte_node* logits = node->children[0], *truth = node->children[1], *pred = node->children[2];
+    int n = scyte_num_elements(logits);
+    float cost = 0.f, logs[SIGMOID_XENT_CHUNK];
+    for(int first = 0; first < n; first += SIGMOID_XENT_CHUNK) {
+        int m = n - first < SIGMOID_XENT_CHUNK ? n - first : SIGMOID_XENT_CHUNK;
+        const float* x = logits->vals + first, *t = truth->vals + first, *p = pred->vals + first;
+        for(int i = 0; i < m; ++i) logs[i] = p[i] > 0.5f ? p[i] : 1.f - p[i];
+        log_cpu(m, logs, logs);
+        for(int i = 0; i < m; ++i) cost += (x[i] > 0.f ? x[i] : 0.f) - x[i]*t[i] - logs[i];
+    }
+    node->vals[0] = cost / (float)n;
+}
+
+void scyte_sigmoid_x_entropy_backward(scyte_node* node)
+{
+    scyte_node* logits = node->children[0], *truth = node->children[1], *pred = node->children[2];
+    if(!scyte_has_gradient(logits)) return;
+    int n = scyte_num_elements(logits);
+    float s = node->delta[0] / (float)n;
+    const float* p = pred->vals, *t = truth->vals;
+    for(int i = 0; i < n; ++i) logits->delta[i] += s*(p[i] - t[i]);
+}
@@ -5,6 +5,9 @@
 
 #include <math.h>
 
+// elements whose cosines are computed at once in the backward pass
+#define SIN_CHUNK 256
+
 int scyte_sin_sync_dims(scyte_node* node)
 {
     scyte_copy_shape(node->children[0], node);
@@ -26,9 +29,7 @@ void scyte_sin_forward(scyte_node* node)
 {
     scyte_node* operand = node->children[0];
     int n = scyte_num_elements(operand);
-    for(int i = 0; i < n; ++i) {
-        node->vals[i] = sinf(operand->vals[i]);
-    }
+    sin_cpu(n, operand->vals, node->vals);
 }
 
 void scyte_sin_backward(scyte_node* node)
@@ -36,8 +37,11 @@ void scyte_sin_backward(scyte_node* node)
     scyte_node* operand = node->children[0];
     int n = scyte_num_elements(operand);
     if(scyte_has_gradient(operand)) {
-        for(int i = 0; i < n; ++i) {
-            operand->delta[i] += node->delta[i]*cosf(operand->vals[i]);
+        float cos_vals[SIN_CHUNK];
+        for(int first = 0; first < n; first += SIN_CHUNK) {
+            int m = n - first < SIN_CHUNK ? n - first : SIN_CHUNK;
+            cos_cpu(m, operand->vals + first, cos_vals);
+            mul_sum_cpu(m, node->delta + first, cos_vals, operand->delta + first);
         }
     }
 }
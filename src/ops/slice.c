@@ -57,6 +57,12 @@ scyte_node* scyte_slice(scyte_node* x, int axis, int start, int size)
     return node;
 }
 
+int scyte_slice_is_view(const scyte_node* node)
+{
+    // slices of the first axis are contiguous, the rows of the other axes are strided by the batch
+    return ((int*)node->params)[0] == 0;
+}
+
 void scyte_slice_forward(scyte_node* node)
 {
     scyte_node* child = node->children[0];
@@ -66,6 +72,11 @@ void scyte_slice_forward(scyte_node* node)
 
     int shape0 = 1, shape1 = 1;
     get_reduced_dimensions(node, axis, &shape0, &shape1);
+    if(axis == 0) {
+        node->vals = child->vals + start*shape1;
+        node->delta = child->delta ? child->delta + start*shape1 : NULL;
+        return;
+    }
 
     for(int i = 0; i < shape0; ++i) {
         copy_cpu(size*shape1, 
@@ -81,6 +92,8 @@ void scyte_slice_backward(scyte_node* node)
     get_slice_params(node,  &axis, &start, &size);
     assert(axis >= 0 && axis < child->num_dims && size > 0);
 
+    // the gradient of a view was accumulated into the input's delta directly
+    if(axis == 0) return;
     int shape0 = 1, shape1 = 1;
     get_reduced_dimensions(node, axis, &shape0, &shape1);
 
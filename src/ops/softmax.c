@@ -36,12 +36,10 @@ void scyte_softmax_forward(scyte_node* node)
         float* out_vals  = &node->vals[i*dim];
         float* in_vals   = &operand->vals[i*dim];
         for(int j = 0; j < dim; ++j) max = (max > in_vals[j]) ? max : in_vals[j];
-        for(int j = 0; j < dim; ++j) {
-            out_vals[j] = expf(in_vals[j] - max);
-            sum += out_vals[j];
-        }
-        float scale = 1.f / (sum + EPS);
-        for(int j = 0; j < dim; ++j) out_vals[j] *= scale;
+        bias_cpu(dim, -max, in_vals, out_vals);
+        exp_cpu(dim, out_vals, out_vals);
+        for(int j = 0; j < dim; ++j) sum += out_vals[j];
+        scale_cpu(dim, 1.f / (sum + EPS), out_vals, out_vals);
     }
 }
 
@@ -0,0 +1,73 @@
+#include "ops/softmax_xent.h"
+
+#include "logger.h"
+#include "op.h"
+
+#include <math.h>
+
+int scyte_softmax_x_entropy_sync_dims(scyte_node* node)
+{
+    scyte_node* logits = node->children[0], *truth = node->children[1];
+    int n0 = scyte_num_elements(logits), n1 = scyte_num_elements(truth);
+    if(n0 != n1 || logits->shape[logits->num_dims - 1] != truth->shape[truth->num_dims - 1]) {
+        LOG_ERRORF("dimensions (%d != %d) were not equal, returning NULL\n", n0, n1);
+        return 0;
+    }
+    node->num_dims = 0;
+    return 1;
+}
+
+scyte_node* scyte_softmax_x_entropy(scyte_node* truth, scyte_node* pred)
+{
+    if(scyte_is_operand(pred) || pred->op_type != SOFTMAX) {
+        LOG_ERROR("the prediction isn't a softmax, returning NULL");
+        return NULL;
+    }
+    scyte_node* children[] = { pred->children[0], truth, pred };
+    scyte_node* node = make_opn_node(SOFTMAX_XENT, 3, children);
+    node->forward = scyte_softmax_x_entropy_forward, node->backward = scyte_softmax_x_entropy_backward;
+    if(!scyte_softmax_x_entropy_sync_dims(node)) {
+        free_op_node(node);
+        return NULL;
+    }
+    return node;
+}
+
+// -sum(t*log(p)) = sum(t*(lse - x)) with lse = max + log(sum(exp(x - max))) over a row. The softmax
+// has already summed the exponentials, p = 1/sum at the max, so lse = max - log(p) there, which
+// never underflows
+void scyte_softmax_x_entropy_forward(scyte_node* node)
+{
+    scyte_node* logits = node->children[0], *truth = node->children[1], *pred = node->children[2];
+    int dim = truth->shape[truth->num_dims - 1];
+    int batch_size = scyte_num_elements(truth) / dim;
+    float cost = 0.f;
+    for(int i = 0; i < batch_size; ++i) {
+        const float* x = &logits->vals[i*dim], *t = &truth->vals[i*dim];
+        int argmax = 0;
+        for(int j = 1; j < dim; ++j) argmax = x[j] > x[argmax] ? j : argmax;
+        float max = x[argmax], dot = 0.f, sum = 0.f;
+        for(int j = 0; j < dim; ++j) {
+            dot += t[j]*(max - x[j]);
+            sum += t[j];
+        }
+        cost += dot - sum*logf(pred->vals[i*dim + argmax]);
+    }
+    node->vals[0] = cost / (float)batch_size;
+}
+
+void scyte_softmax_x_entropy_backward(scyte_node* node)
+{
+    scyte_node* logits = node->children[0], *truth = node->children[1], *pred = node->children[2];
+    if(!scyte_has_gradient(logits)) return;
+    int dim = truth->shape[truth->num_dims - 1];
+    int batch_size = scyte_num_elements(truth) / dim;
+    float s = node->delta[0] / (float)batch_size;
+    // d/dx sum(t*(lse - x)) = p*sum(t) - t, which is p - t for one-hot or normalized targets
+    for(int i = 0; i < batch_size; ++i) {
+        const float* p = &pred->vals[i*dim], *t = &truth->vals[i*dim];
+        float* dx = &logits->delta[i*dim], sum = 0.f;
+        for(int j = 0; j < dim; ++j) sum += t[j];
+        for(int j = 0; j < dim; ++j) dx[j] += s*(p[j]*sum - t[j]);
+    }
+}
@@ -27,11 +27,7 @@ void scyte_tanh_forward(scyte_node* node)
 {
     scyte_node* operand = node->children[0];
     int n = scyte_num_elements(operand);
-    float y;
-    for(int i = 0; i < n; ++i) {
-        y = expf(-2.f*operand->vals[i]);
-        node->vals[i] = (1.f - y) / (1.f + y);
-    }
+    tanh_cpu(n, operand->vals, node->vals);
 }
 
 void scyte_tanh_backward(scyte_node* node)
@@ -41,7 +37,7 @@ void scyte_tanh_backward(scyte_node* node)
     if(scyte_has_gradient(operand)) {
         float tanh_val;
         for(int i = 0; i < n; ++i) {
-            tanh_val = operand->vals[i];
+            tanh_val = node->vals[i];
             operand->delta[i] += node->delta[i]*(1.f - tanh_val*tanh_val);
         }
     }
@@ -0,0 +1,136 @@
+#include "ops/transpose.h"
+
+#include "logger.h"
+#include "op.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// elements gathered or scattered per task when packed
+#define TRANSPOSE_CHUNK 4096
+
+// params: packed, then the permutation
+static inline int is_packed(const scyte_node* node)
+{
+    return ((int*)node->params)[0];
+}
+
+static inline const int* get_perm(const scyte_node* node)
+{
+    return (int*)node->params + 1;
+}
+
+// the strides the output is read with from the child's memory
+static void get_view_strides(const scyte_node* node, int strides[SCYTE_MAX_DIMS])
+{
+    int child_strides[SCYTE_MAX_DIMS];
+    const int* perm = get_perm(node);
+    scyte_get_strides(node->children[0], child_strides);
+    for(int i = 0; i < node->num_dims; ++i) strides[i] = child_strides[perm[i]];
+}
+
+static void sync_strides(scyte_node* node)
+{
+    memset(node->strides, 0, sizeof(node->strides));
+    if(is_packed(node)) return;
+    // a view whose strides are those of its row-major layout is contiguous
+    int strides[SCYTE_MAX_DIMS], dense[SCYTE_MAX_DIMS];
+    get_view_strides(node, strides);
+    scyte_get_strides(node, dense);
+    if(memcmp(strides, dense, node->num_dims*sizeof(int)) != 0) memcpy(node->strides, strides, node->num_dims*sizeof(int));
+}
+
+int scyte_transpose_sync_dims(scyte_node* node)
+{
+    scyte_node* x = node->children[0];
+    const int* perm = get_perm(node);
+    int num_dims = (node->params_size / sizeof(int)) - 1, seen = 0;
+    if(num_dims != x->num_dims) {
+        LOG_ERRORF("the permutation has %d axes, the input %d", num_dims, x->num_dims);
+        return 0;
+    }
+    for(int i = 0; i < num_dims; ++i) {
+        if(perm[i] < 0 || perm[i] >= num_dims || (seen & (1 << perm[i]))) {
+            LOG_ERRORF("axis %d isn't a permutation of the input's axes", i);
+            return 0;
+        }
+        seen |= 1 << perm[i];
+    }
+    node->num_dims = num_dims, node->layout = SCYTE_NCHW;
+    for(int i = 0; i < num_dims; ++i) node->shape[i] = x->shape[perm[i]];
+    sync_strides(node);
+    return 1;
+}
+
+scyte_node* scyte_transpose(scyte_node* x, const int* perm)
+{
+    if(x->num_dims < 1) {
+        LOG_ERROR("can't transpose a scalar");
+        return NULL;
+    }
+    scyte_node* node = make_op1_node(TRANSPOSE, x);
+    int* params = (int*)calloc(1 + x->num_dims, sizeof(int));
+    for(int i = 0; i < x->num_dims; ++i) params[1 + i] = perm ? perm[i] : x->num_dims - 1 - i;
+    node->params = params;
+    node->params_size = (1 + x->num_dims)*sizeof(int);
+    node->forward = scyte_transpose_forward, node->backward = scyte_transpose_backward;
+    if(!scyte_transpose_sync_dims(node)) {
+        free_op_node(node);
+        return NULL;
+    }
+    char perm_string[4*SCYTE_MAX_DIMS] = "";
+    for(int i = 0; i < x->num_dims; ++i) sprintf(perm_string + strlen(perm_string), i ? ",%d" : "%d", params[1 + i]);
+    char* input_shape = get_shape_string(x->num_dims, x->shape);
+    char* output_shape = get_shape_string(node->num_dims, node->shape);
+    fprintf(stderr, "transpose  perm=%s    %s -> %s\n", perm_string, input_shape, output_shape);
+    free(input_shape);
+    free(output_shape);
+
+    return node;
+}
+
+int scyte_transpose_is_view(const scyte_node* node)
+{
+    return !is_packed(node);
+}
+
+void scyte_set_transpose_packed(scyte_node* node, int packed)
+{
+    ((int*)node->params)[0] = packed;
+    scyte_transpose_sync_dims(node);
+}
+
+void scyte_transpose_forward(scyte_node* node)
+{
+    scyte_node* child = node->children[0];
+    if(!is_packed(node)) {
+        // the child may have been packed, or folded into a constant, since the dims were synced
+        sync_strides(node);
+        node->vals = child->vals, node->delta = child->delta;
+        return;
+    }
+    int size = scyte_num_elements(node), strides[SCYTE_MAX_DIMS];
+    get_view_strides(node, strides);
+    #pragma omp parallel for
+    for(int first = 0; first < size; first += TRANSPOSE_CHUNK) {
+        int n = size - first < TRANSPOSE_CHUNK ? size - first : TRANSPOSE_CHUNK;
+        scyte_gather_strided(node, strides, child->vals, first, n, node->vals + first);
+    }
+}
+
+void scyte_transpose_backward(scyte_node* node)
+{
+    scyte_node* child = node->children[0];
+    // a view's gradient was accumulated into the input's delta directly
+    if(!is_packed(node) || !scyte_has_gradient(child)) return;
+    int size = scyte_num_elements(node), strides[SCYTE_MAX_DIMS];
+    get_view_strides(node, strides);
+    // the chunks scatter into distinct elements
+    #pragma omp parallel for
+    for(int first = 0; first < size; first += TRANSPOSE_CHUNK) {
+        int n = size - first < TRANSPOSE_CHUNK ? size - first : TRANSPOSE_CHUNK;
+        scyte_scatter_add_strided(node, strides, node->delta + first, first, n, child->delta);
+    }
+}
@@ -0,0 +1,195 @@
+#include "planner.h"
+
+#include "op.h"
+
+#include <stdlib.h>
+#include <limits.h>
+
+// buffers are padded to a multiple of 16 floats, keeping every buffer 64-byte aligned
+#define PLAN_ALIGN 16
+
+typedef struct {
+    int start, end;
+} lifetime;
+
+typedef struct {
+    long* offset;       // where the assigned offset is written to
+    size_t size;
+    // lifetimes in nodes, forward step of node i is i and backward step is 2*n-1-i, and in levels
+    // for concurrent plans, see count_levels
+    lifetime steps, levels;
+} plan_buffer;
+
+static int compare_buffers(const void* a, const void* b)
+{
+    const plan_buffer* x = *(const plan_buffer**)a, *y = *(const plan_buffer**)b;
+    if(x->size != y->size) return x->size < y->size ? 1 : -1;
+    return x->steps.start - y->steps.start;
+}
+
+static int compare_offsets(const void* a, const void* b)
+{
+    const plan_buffer* x = *(const plan_buffer**)a, *y = *(const plan_buffer**)b;
+    return (*x->offset > *y->offset) - (*x->offset < *y->offset);
+}
+
+static inline void add_buffer(plan_buffer* buffers, int* num_buffers, long* offset, int size, lifetime steps, lifetime levels)
+{
+    plan_buffer* b = &buffers[(*num_buffers)++];
+    b->offset = offset, b->steps = steps, b->levels = levels;
+    b->size = ((size_t)size + PLAN_ALIGN - 1) / PLAN_ALIGN * PLAN_ALIGN;
+}
+
+static inline int overlap(lifetime a, lifetime b)
+{
+    return a.end >= b.start && b.end >= a.start;
+}
+
+// greedy-by-size placement: the largest buffers are placed first, each at the lowest
+// offset that doesn't collide with an already placed buffer with an overlapping lifetime
+static size_t assign_offsets(int num_buffers, plan_buffer* buffers)
+{
+    size_t arena_size = 0;
+    plan_buffer** sorted = (plan_buffer**)malloc(num_buffers*sizeof(plan_buffer*));
+    plan_buffer** live = (plan_buffer**)malloc(num_buffers*sizeof(plan_buffer*));
+    for(int i = 0; i < num_buffers; ++i) sorted[i] = &buffers[i];
+    qsort(sorted, num_buffers, sizeof(plan_buffer*), compare_buffers);
+    for(int i = 0; i < num_buffers; ++i) {
+        plan_buffer* b = sorted[i];
+        int num_live = 0;
+        for(int j = 0; j < i; ++j) {
+            if(overlap(sorted[j]->steps, b->steps) || overlap(sorted[j]->levels, b->levels)) live[num_live++] = sorted[j];
+        }
+        qsort(live, num_live, sizeof(plan_buffer*), compare_offsets);
+        size_t offset = 0;
+        for(int j = 0; j < num_live; ++j) {
+            if(offset + b->size <= (size_t)*live[j]->offset) break;
+            size_t live_end = *live[j]->offset + live[j]->size;
+            if(live_end > offset) offset = live_end;
+        }
+        *b->offset = offset;
+        if(offset + b->size > arena_size) arena_size = offset + b->size;
+    }
+    free(sorted); free(live);
+    return arena_size;
+}
+
+// The depth of every node, the nodes of a level may run in any order. Returns the number of levels
+static int count_levels(int n, scyte_node** nodes, int* level)
+{
+    int num_levels = 1;
+    for(int i = 0; i < n; ++i) {
+        level[i] = 0;
+        for(int j = 0; j < nodes[i]->num_children; ++j) {
+            int child = level[nodes[i]->children[j]->mark] + 1;
+            if(child > level[i]) level[i] = child;
+        }
+        if(level[i] + 1 > num_levels) num_levels = level[i] + 1;
+    }
+    return num_levels;
+}
+
+// lifetimes of the values and deltas of the op-nodes, with node i run at step[i] of num_steps
+static void get_lifetimes(int n, scyte_node** nodes, int mode, const int* step, int num_steps, lifetime* vals, lifetime* deltas)
+{
+    int* last_consumer = (int*)malloc(n*sizeof(int));
+    int* keep = (int*)malloc(n*sizeof(int));
+    int last = 2*num_steps - 1;
+    for(int i = 0; i < n; ++i) last_consumer[i] = -1;
+    for(int i = 0; i < n; ++i) {
+        for(int j = 0; j < nodes[i]->num_children; ++j) {
+            int child = nodes[i]->children[j]->mark;
+            if(step[i] > last_consumer[child]) last_consumer[child] = step[i];
+        }
+    }
+    // values of roots, outputs and costs are read after the graph has been run
+    for(int i = 0; i < n; ++i) keep[i] = last_consumer[i] < 0 || (nodes[i]->type & (OUTPUT | COST));
+    // the memory of a view's children is read, and accumulated into, for as long as the view's is.
+    // views come after their children, so a view of a view passes its lifetime on in turn
+    for(int i = n - 1; i >= 0; --i) {
+        if(!scyte_is_view(nodes[i])) continue;
+        for(int j = 0; j < nodes[i]->num_children; ++j) {
+            int child = nodes[i]->children[j]->mark;
+            if(last_consumer[i] > last_consumer[child]) last_consumer[child] = last_consumer[i];
+            keep[child] |= keep[i];
+        }
+    }
+    for(int i = 0; i < n; ++i) {
+        if(mode & SCYTE_PLAN_PREDICT) {
+            vals[i] = (lifetime){ step[i], keep[i] ? INT_MAX : last_consumer[i] };
+            continue;
+        }
+        // values are read until the node itself has been backpropagated through,
+        // deltas are written by the first parent and read by the node's own backward
+        vals[i] = (lifetime){ step[i], keep[i] ? INT_MAX : last - step[i] };
+        deltas[i] = (lifetime){ last_consumer[i] < 0 ? num_steps : last - last_consumer[i], last - step[i] };
+    }
+    free(last_consumer); free(keep);
+}
+
+scyte_memory_plan scyte_plan_memory(int n, scyte_node** nodes, int mode)
+{
+    scyte_memory_plan plan = { mode, n, 0, NULL, NULL };
+    plan.val_offsets = (long*)malloc(n*sizeof(long));
+    plan.delta_offsets = (long*)malloc(n*sizeof(long));
+    int* step = (int*)calloc(n, sizeof(int));
+    lifetime* lifetimes = (lifetime*)malloc(4*n*sizeof(lifetime));
+    lifetime* val_steps = lifetimes, *delta_steps = lifetimes + n, *val_levels = lifetimes + 2*n, *delta_levels = lifetimes + 3*n;
+    plan_buffer* buffers = (plan_buffer*)malloc(2*n*sizeof(plan_buffer));
+    int num_buffers = 0;
+
+    for(int i = 0; i < n; ++i) {
+        nodes[i]->mark = i, step[i] = i;
+        plan.val_offsets[i] = plan.delta_offsets[i] = -1;
+    }
+    // The steps run in the order of the nodes, or in any order that keeps the levels for concurrent
+    // plans. Buffers whose lifetimes overlap in either can't be shared then: the scheduler orders
+    // the steps sharing memory as the nodes are, and the levels keep side by side branches apart
+    get_lifetimes(n, nodes, mode, step, n, val_steps, delta_steps);
+    if(mode & SCYTE_PLAN_CONCURRENT) {
+        int num_levels = count_levels(n, nodes, step);
+        get_lifetimes(n, nodes, mode, step, num_levels, val_levels, delta_levels);
+    }
+    else val_levels = val_steps, delta_levels = delta_steps;
+
+    for(int i = 0; i < n; ++i) {
+        scyte_node* node = nodes[i];
+        if(scyte_is_operand(node) || scyte_is_view(node)) continue;
+        int size = scyte_num_elements(node);
+        add_buffer(buffers, &num_buffers, &plan.val_offsets[i], size, val_steps[i], val_levels[i]);
+        if(!(mode & SCYTE_PLAN_PREDICT) && scyte_has_gradient(node)) {
+            add_buffer(buffers, &num_buffers, &plan.delta_offsets[i], size, delta_steps[i], delta_levels[i]);
+        }
+    }
+    for(int i = 0; i < n; ++i) nodes[i]->mark = 0;
+    plan.size = assign_offsets(num_buffers, buffers);
+
+    free(buffers); free(lifetimes); free(step);
+    return plan;
+}
+
+void scyte_bind_memory(int n, scyte_node** nodes, const scyte_memory_plan* plan, float* arena)
+{
+    for(int i = 0; i < n; ++i) {
+        scyte_node* node = nodes[i];
+        if(scyte_is_operand(node) || scyte_is_view(node)) continue;
+        node->vals = plan->val_offsets[i] >= 0 ? arena + plan->val_offsets[i] : NULL;
+        node->delta = plan->delta_offsets[i] >= 0 ? arena + plan->delta_offsets[i] : NULL;
+    }
+}
+
+void scyte_release_op_buffers(int n, scyte_node** nodes)
+{
+    for(int i = 0; i < n; ++i) {
+        scyte_node* node = nodes[i];
+        if(scyte_is_operand(node) || scyte_is_view(node)) continue;
+        free(node->vals), free(node->delta);
+        node->vals = node->delta = NULL;
+    }
+}
+
+void scyte_free_memory_plan(scyte_memory_plan* plan)
+{
+    free(plan->val_offsets), free(plan->delta_offsets);
+    plan->val_offsets = plan->delta_offsets = NULL;
+}
@@ -0,0 +1,238 @@
+#include "pool.h"
+
+#include "layout.h"
+#include "logger.h"
+
+#include <float.h>
+#include <stdlib.h>
+
+// the half of the padding before the first row and column
+static inline int pool_offset(const scyte_pool* pool)
+{
+    return -pool->padding / 2;
+}
+
+// the first and last + 1 elements of the window starting at start that lie inside the input
+static inline void window_range(int start, int size, int in, int* begin, int* end)
+{
+    *begin = start < 0 ? -start : 0;
+    *end = start + size > in ? in - start : size;
+    if(*end < *begin) *end = *begin;
+}
+
+int scyte_pool_sync_dims(const scyte_pool* pool, const scyte_node* x, scyte_node* node)
+{
+    if(x->num_dims != 4) {
+        LOG_ERRORF("x has %d dimension(s), it must have shape NCHW", x->num_dims);
+        return 0;
+    }
+    int out_h = (x->shape[2] + pool->padding - pool->size_h)/pool->stride + 1;
+    int out_w = (x->shape[3] + pool->padding - pool->size_w)/pool->stride + 1;
+    if(pool->size_h < 1 || pool->size_w < 1 || pool->stride < 1 || out_h < 1 || out_w < 1) {
+        LOG_ERRORF("can't pool %d x %d windows with stride %d and padding %d over %d x %d",
+                pool->size_h, pool->size_w, pool->stride, pool->padding, x->shape[2], x->shape[3]);
+        return 0;
+    }
+    node->num_dims = 4;
+    node->shape[0] = x->shape[0];
+    node->shape[1] = x->shape[1];
+    node->shape[2] = out_h;
+    node->shape[3] = out_w;
+    node->layout = x->layout;
+    return 1;
+}
+
+// Every row of a block of channels is contiguous in all layouts, with the block's channels
+// innermost: the element (x, k) of a row is at x*block + k. Its rows are reduced one at a time into
+// the row of the output, whose windows start at the identity of the pool
+
+static inline void reduce_lanes(scyte_pool_type type, const float* v, int index, int block, float* o, int* oi)
+{
+    if(type == SCYTE_POOL_AVG) {
+        for(int k = 0; k < block; ++k) o[k] += v[k];
+    } else if(oi) {
+        for(int k = 0; k < block; ++k) {
+            int greater = v[k] > o[k];
+            o[k] = greater ? v[k] : o[k];
+            oi[k] = greater ? index + k : oi[k];
+        }
+    } else {
+        for(int k = 0; k < block; ++k) o[k] = v[k] > o[k] ? v[k] : o[k];
+    }
+}
+
+// the windows of the output columns [j0, j1), clamped to the row
+static void reduce_columns(const scyte_pool* pool, const float* row, int row_offset, int in_w, int block,
+        int j0, int j1, float* o, int* oi)
+{
+    for(int j = j0; j < j1; ++j) {
+        int start = pool_offset(pool) + j*pool->stride, m0, m1;
+        window_range(start, pool->size_w, in_w, &m0, &m1);
+        for(int m = m0; m < m1; ++m) {
+            int col = (start + m)*block;
+            reduce_lanes(pool->type, row + col, row_offset + col, block, o + j*block, oi ? oi + j*block : NULL);
+        }
+    }
+}
+
+// NCHW rows have a single lane, so the windows are vectorized over the output columns instead. None
+// of the windows of [j0, j1) crosses the border, and the loop over a window unrolls when the kernel
+// is inlined with a constant size and stride
+static inline __attribute__((always_inline)) void reduce_interior(scyte_pool_type type, int size, int stride,
+        const float* row, int row_offset, int start, int j0, int j1, float* o, int* oi)
+{
+    if(type == SCYTE_POOL_AVG) {
+        for(int j = j0; j < j1; ++j) {
+            const float* v = row + start + j*stride;
+            float sum = 0.f;
+            for(int m = 0; m < size; ++m) sum += v[m];
+            o[j] += sum;
+        }
+    } else if(oi) {
+        // one element of every window at a time, a compare and two selects over the columns like
+        // reduce_lanes, which keeps the first max of a window
+        for(int m = 0; m < size; ++m) {
+            const float* v = row + start + m;
+            int index = row_offset + start + m;
+            for(int j = j0; j < j1; ++j) {
+                int greater = v[j*stride] > o[j];
+                o[j] = greater ? v[j*stride] : o[j];
+                oi[j] = greater ? index + j*stride : oi[j];
+            }
+        }
+    } else {
+        for(int j = j0; j < j1; ++j) {
+            const float* v = row + start + j*stride;
+            float max = v[0];
+            for(int m = 1; m < size; ++m) max = v[m] > max ? v[m] : max;
+            o[j] = max > o[j] ? max : o[j];
+        }
+    }
+}
+
+static void reduce_row(const scyte_pool* pool, const float* row, int row_offset, int in_w, int block,
+        int out_w, int j0, int j1, float* o, int* oi)
+{
+    if(block > 1) {
+        reduce_columns(pool, row, row_offset, in_w, block, 0, out_w, o, oi);
+        return;
+    }
+    int size = pool->size_w, stride = pool->stride, start = pool_offset(pool);
+    reduce_columns(pool, row, row_offset, in_w, 1, 0, j0, o, oi);
+    if(size == 2 && stride == 2) reduce_interior(pool->type, 2, 2, row, row_offset, start, j0, j1, o, oi);
+    else if(size == 3 && stride == 1) reduce_interior(pool->type, 3, 1, row, row_offset, start, j0, j1, o, oi);
+    else if(size == 3 && stride == 2) reduce_interior(pool->type, 3, 2, row, row_offset, start, j0, j1, o, oi);
+    else if(size == 2 && stride == 1) reduce_interior(pool->type, 2, 1, row, row_offset, start, j0, j1, o, oi);
+    else reduce_interior(pool->type, size, stride, row, row_offset, start, j0, j1, o, oi);
+    reduce_columns(pool, row, row_offset, in_w, 1, j1, out_w, o, oi);
+}
+
+typedef struct {
+    int in_h, in_w, out_w, block, start;
+    int j0, j1; // the output columns whose windows lie entirely inside the input
+    scyte_layout_strides in;
+} pool_geometry;
+
+static pool_geometry get_geometry(const scyte_pool* pool, const scyte_node* x, const scyte_node* y)
+{
+    pool_geometry g;
+    g.in_h = x->shape[2], g.in_w = x->shape[3], g.out_w = y->shape[3];
+    g.in = scyte_layout_get_strides(x->layout, x->shape);
+    g.block = g.in.block, g.start = pool_offset(pool);
+    g.j0 = (-g.start + pool->stride - 1) / pool->stride;
+    g.j1 = g.in_w - pool->size_w - g.start < 0 ? 0 : (g.in_w - pool->size_w - g.start) / pool->stride + 1;
+    if(g.j0 > g.out_w) g.j0 = g.out_w;
+    if(g.j1 > g.out_w) g.j1 = g.out_w;
+    if(g.j1 < g.j0) g.j1 = g.j0;
+    return g;
+}
+
+// pools the output row i of the block of channels cb of image b into o and oi
+static void pool_row(const scyte_pool* pool, const pool_geometry* g, const float* x, int b, int cb, int i, float* o, int* oi)
+{
+    int row_size = g->out_w*g->block;
+    float identity = pool->type == SCYTE_POOL_MAX ? -FLT_MAX : 0.f;
+    for(int k = 0; k < row_size; ++k) o[k] = identity;
+    if(oi) for(int k = 0; k < row_size; ++k) oi[k] = -1;
+
+    int top = g->start + i*pool->stride, n0, n1;
+    window_range(top, pool->size_h, g->in_h, &n0, &n1);
+    for(int n = n0; n < n1; ++n) {
+        int row_offset = scyte_layout_offset(&g->in, b, cb*g->block, top + n, 0);
+        reduce_row(pool, x + row_offset, row_offset, g->in_w, g->block, g->out_w, g->j0, g->j1, o, oi);
+    }
+    if(pool->type == SCYTE_POOL_AVG) {
+        for(int j = 0; j < g->out_w; ++j) {
+            int m0, m1;
+            window_range(g->start + j*pool->stride, pool->size_w, g->in_w, &m0, &m1);
+            int count = (n1 - n0)*(m1 - m0);
+            float scale = count > 0 ? 1.f / count : 0.f;
+            for(int k = 0; k < g->block; ++k) o[j*g->block + k] *= scale;
+        }
+    }
+}
+
+void scyte_pool_forward(const scyte_pool* pool, const scyte_node* x, scyte_node* y, int* indexes)
+{
+    pool_geometry g = get_geometry(pool, x, y);
+    scyte_layout_strides out = scyte_layout_get_strides(y->layout, y->shape);
+    int batch = y->shape[0], out_h = y->shape[2], num_blocks = y->shape[1] / g.block;
+    if(pool->type != SCYTE_POOL_MAX) indexes = NULL;
+
+    #pragma omp parallel for
+    for(int p = 0; p < batch*num_blocks*out_h; ++p) {
+        int b = p / (num_blocks*out_h), cb = p / out_h % num_blocks, i = p % out_h;
+        size_t out_offset = scyte_layout_offset(&out, b, cb*g.block, i, 0);
+        pool_row(pool, &g, x->vals, b, cb, i, y->vals + out_offset, indexes ? indexes + out_offset : NULL);
+    }
+}
+
+// Every block of channels of an image is contiguous in all layouts, and the windows never leave it,
+// so the blocks are spread over the threads without two of them writing the same gradient
+void scyte_pool_backward(const scyte_pool* pool, scyte_node* x, const scyte_node* y, const int* indexes)
+{
+    pool_geometry g = get_geometry(pool, x, y);
+    scyte_layout_strides in = g.in, out = scyte_layout_get_strides(y->layout, y->shape);
+    int batch = y->shape[0], out_h = y->shape[2], out_w = y->shape[3];
+    int in_h = g.in_h, in_w = g.in_w, block = g.block, start = g.start, num_blocks = y->shape[1] / block;
+    int block_size = out_h*out_w*block;
+
+    #pragma omp parallel for
+    for(int p = 0; p < batch*num_blocks; ++p) {
+        int b = p / num_blocks, cb = p % num_blocks;
+        if(pool->type == SCYTE_POOL_MAX) {
+            // without indexes, the max of every row of windows is found again by the forward kernels
+            float* max = indexes ? NULL : (float*)malloc(out_w*block*sizeof(float));
+            int* row_indexes = indexes ? NULL : (int*)malloc(out_w*block*sizeof(int));
+            for(int i = 0; i < out_h; ++i) {
+                const int* idx = indexes ? indexes + p*block_size + i*out_w*block : row_indexes;
+                const float* dy = y->delta + p*block_size + i*out_w*block;
+                if(!indexes) pool_row(pool, &g, x->vals, b, cb, i, max, row_indexes);
+                // windows entirely in the padding have no max
+                for(int k = 0; k < out_w*block; ++k) {
+                    if(idx[k] >= 0) x->delta[idx[k]] += dy[k];
+                }
+            }
+            free(max); free(row_indexes);
+            continue;
+        }
+        for(int i = 0; i < out_h; ++i) {
+            int top = start + i*pool->stride, n0, n1;
+            window_range(top, pool->size_h, in_h, &n0, &n1);
+            for(int j = 0; j < out_w; ++j) {
+                int left = start + j*pool->stride, m0, m1;
+                window_range(left, pool->size_w, in_w, &m0, &m1);
+                size_t out_offset = scyte_layout_offset(&out, b, cb*block, i, j);
+                int count = (n1 - n0)*(m1 - m0);
+                if(count == 0) continue;
+                float scale = 1.f / count;
+                for(int n = n0; n < n1; ++n) {
+                    for(int m = m0; m < m1; ++m) {
+                        float* dx = x->delta + scyte_layout_offset(&in, b, cb*block, top + n, left + m);
+                        for(int k = 0; k < block; ++k) dx[k] += scale*y->delta[out_offset + k];
+                    }
+                }
+            }
+        }
+    }
+}
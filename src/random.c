@@ -0,0 +1,90 @@
+#include "random.h"
+
+#include <stddef.h>
+
+static uint64_t thread_rng_seed = 0x5c47e;
+static int thread_rng_generation = 1; // bumped on reseeding, so every thread reseeds on its next use
+
+static __thread scyte_rng thread_rng;
+static __thread scyte_rng* swapped_rng = NULL;
+static __thread uint64_t thread_rng_id = 0;
+static __thread int thread_generation = 0;  // generation the thread's generator was seeded for
+
+static inline uint64_t rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t splitmix64(uint64_t* x)
+{
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+void scyte_rng_seed(scyte_rng* rng, uint64_t seed)
+{
+    for(int i = 0; i < 4; ++i) rng->s[i] = splitmix64(&seed);
+}
+
+uint64_t scyte_rng_next(scyte_rng* rng)
+{
+    uint64_t* s = rng->s;
+    uint64_t result = rotl(s[1]*5, 7)*9, t = s[1] << 17;
+    s[2] ^= s[0], s[3] ^= s[1], s[1] ^= s[2], s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+uint32_t scyte_rng_bounded(scyte_rng* rng, uint32_t n)
+{
+    // multiply-shift instead of a modulo, see Lemire, "Fast Random Integer Generation in an Interval"
+    return (uint32_t)(((scyte_rng_next(rng) >> 32)*n) >> 32);
+}
+
+float scyte_rng_uniform(scyte_rng* rng, float min, float max)
+{
+    // the upper 24 bits fill the mantissa of a float in [0, 1)
+    return min + (max - min)*((scyte_rng_next(rng) >> 40)*0x1.0p-24f);
+}
+
+void scyte_rng_shuffle(scyte_rng* rng, int n, int* a)
+{
+    for(int i = n-1; i > 0; --i) {
+        int j = scyte_rng_bounded(rng, i + 1);
+        int swap = a[i];
+        a[i] = a[j], a[j] = swap;
+    }
+}
+
+scyte_rng* scyte_thread_rng()
+{
+    if(swapped_rng) return swapped_rng;
+    int current = __atomic_load_n(&thread_rng_generation, __ATOMIC_ACQUIRE);
+    if(thread_generation != current) {
+        scyte_rng_seed(&thread_rng, thread_rng_seed + thread_rng_id);
+        thread_generation = current;
+    }
+    return &thread_rng;
+}
+
+void scyte_seed_thread_rngs(uint64_t seed)
+{
+    thread_rng_seed = seed;
+    __atomic_add_fetch(&thread_rng_generation, 1, __ATOMIC_RELEASE);
+}
+
+void scyte_seed_thread_rng(uint64_t id)
+{
+    thread_rng_id = id;
+    thread_generation = 0;
+}
+
+scyte_rng* scyte_swap_thread_rng(scyte_rng* rng)
+{
+    scyte_rng* prev = swapped_rng;
+    swapped_rng = rng;
+    return prev;
+}
@@ -0,0 +1,202 @@
+#include "replica.h"
+
+#include "blas.h"
+#include "logger.h"
+#include "planner.h"
+#include "random.h"
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// the gradient is reduced in chunks of this many floats per thread, keeping chunks cache line aligned
+#define REDUCE_ALIGN 16
+
+static void plan_replica(scyte_replica* rep, int batch_size)
+{
+    scyte_resync_batch_size(rep->n, rep->nodes, batch_size);
+    scyte_memory_plan plan = scyte_plan_memory(rep->n, rep->nodes, SCYTE_PLAN_TRAIN);
+    rep->arena = (float*)realloc(rep->arena, plan.size*sizeof(float));
+    scyte_bind_memory(rep->n, rep->nodes, &plan, rep->arena);
+    scyte_free_memory_plan(&plan);
+    rep->batch_size = batch_size;
+}
+
+static void run_replica(scyte_replicas* r, scyte_replica* rep)
+{
+    int batch_size = rep->num_samples;
+    if(batch_size == 0) return;
+    if(batch_size != rep->batch_size) plan_replica(rep, batch_size);
+    for(int i = 0; i < rep->n; ++i) {
+        scyte_node* node = rep->nodes[i];
+        if(!scyte_is_placeholder(node)) continue;
+        float* vals = scyte_is_input(node) ? r->X : r->y;
+        // placeholders hold one sample per row, so a replica's slice starts at its offset
+        scyte_feed_placeholder(node, vals + rep->offset*(scyte_num_elements(node) / batch_size));
+    }
+    rep->cost = *scyte_run_exec(rep->forward);
+    if(r->calc_grads) scyte_run_exec(rep->backward);
+}
+
+// each thread sums its own chunk of the gradient over all replicas, weighted by their share of
+// the minibatch, so the reduction is spread evenly over the threads without any locking
+static void reduce_gradients(scyte_replicas* r, int id)
+{
+    int chunk = (r->num_vars + r->num_replicas - 1) / r->num_replicas;
+    chunk = (chunk + REDUCE_ALIGN - 1) / REDUCE_ALIGN * REDUCE_ALIGN;
+    int start = id*chunk, end = start + chunk < r->num_vars ? start + chunk : r->num_vars;
+    if(start >= end) return;
+    float* out = r->net->deltas + start;
+    int first = 1;
+    for(int k = 0; k < r->num_replicas; ++k) {
+        scyte_replica* rep = &r->replicas[k];
+        if(rep->num_samples == 0) continue;
+        float weight = (float)rep->num_samples / r->batch_size; // costs are averaged over the batch
+        if(first) scale_cpu(end - start, weight, rep->deltas + start, out), first = 0;
+        else axpy_cpu(end - start, weight, rep->deltas + start, out);
+    }
+}
+
+static void run_step(scyte_replicas* r, int id)
+{
+    scyte_replica* rep = &r->replicas[id];
+    int share = r->batch_size / r->num_replicas, rest = r->batch_size % r->num_replicas;
+    rep->num_samples = share + (id < rest);
+    rep->offset = id*share + (id < rest ? id : rest);
+    run_replica(r, rep);
+    if(!r->calc_grads) return;
+    pthread_barrier_wait(&r->barrier);
+    reduce_gradients(r, id);
+}
+
+// params can grow while running, e.g. a conv saved before it had an algorithm stores its selection
+static void copy_params(scyte_node* dst, const scyte_node* src)
+{
+    if(src->params_size == 0) return;
+    if(dst->params_size != src->params_size) {
+        dst->params = realloc(dst->params, src->params_size);
+        dst->params_size = src->params_size;
+    }
+    memcpy(dst->params, src->params, src->params_size);
+}
+
+typedef struct {
+    scyte_replicas* r;
+    int id;
+} worker_args;
+
+static void* worker_loop(void* arg)
+{
+    worker_args args = *(worker_args*)arg;
+    free(arg);
+#ifdef _OPENMP
+    omp_set_num_threads(1); // the replicas already keep the cores busy
+#endif
+    scyte_seed_thread_rng(args.id); // replica 0 draws from the caller's stream
+    for(;;) {
+        pthread_barrier_wait(&args.r->barrier);
+        if(args.r->stop) break;
+        run_step(args.r, args.id);
+        pthread_barrier_wait(&args.r->barrier);
+    }
+    return NULL;
+}
+
+scyte_replicas* scyte_make_replicas(scyte_network* net, int num_replicas)
+{
+    if(num_replicas < 1) {
+        LOG_ERRORF("couldn't make %d replicas", num_replicas);
+        return NULL;
+    }
+    scyte_replicas* r = (scyte_replicas*)calloc(1, sizeof(scyte_replicas));
+    r->net = net;
+    r->num_replicas = num_replicas;
+    r->cost_idx = scyte_find_node(net, COST);
+    for(int i = 0; i < net->n; ++i) {
+        if(scyte_is_var(net->nodes[i])) r->num_vars += scyte_num_elements(net->nodes[i]);
+    }
+    r->replicas = (scyte_replica*)calloc(num_replicas, sizeof(scyte_replica));
+    for(int k = 0; k < num_replicas; ++k) {
+        scyte_replica* rep = &r->replicas[k];
+        rep->n = net->n;
+        rep->nodes = scyte_copy_graph(net->n, net->nodes, 1);
+        rep->deltas = (float*)calloc(r->num_vars, sizeof(float));
+        for(int i = 0, j = 0; i < rep->n; ++i) {
+            scyte_node* node = rep->nodes[i];
+            if(!scyte_is_var(node)) continue;
+            node->delta = &rep->deltas[j];
+            j += scyte_num_elements(node);
+        }
+        scyte_release_op_buffers(rep->n, rep->nodes);
+        plan_replica(rep, 1);
+        rep->forward = scyte_compile_exec(rep->n, rep->nodes, r->cost_idx, 0);
+        rep->backward = scyte_compile_exec(rep->n, rep->nodes, r->cost_idx, 1);
+    }
+    pthread_barrier_init(&r->barrier, NULL, num_replicas);
+    r->threads = (pthread_t*)calloc(num_replicas, sizeof(pthread_t));
+    for(int k = 1; k < num_replicas; ++k) {
+        worker_args* args = (worker_args*)malloc(sizeof(worker_args));
+        args->r = r, args->id = k;
+        pthread_create(&r->threads[k], NULL, worker_loop, args);
+    }
+    return r;
+}
+
+void scyte_free_replicas(scyte_replicas* r)
+{
+    if(!r) return;
+    r->stop = 1;
+    pthread_barrier_wait(&r->barrier);
+    for(int k = 1; k < r->num_replicas; ++k) pthread_join(r->threads[k], NULL);
+    pthread_barrier_destroy(&r->barrier);
+    // ops may store state in their params while running, e.g. the algorithm selected by a conv
+    scyte_replica* first = &r->replicas[0];
+    for(int i = 0; i < first->n; ++i) copy_params(r->net->nodes[i], first->nodes[i]);
+    for(int k = 0; k < r->num_replicas; ++k) {
+        scyte_replica* rep = &r->replicas[k];
+        for(int i = 0; i < rep->n; ++i) {
+            scyte_node* node = rep->nodes[i];
+            // the weights belong to the network, and the rest to the arena and the collated deltas
+            node->vals = node->delta = NULL;
+        }
+        scyte_free_graph(rep->n, rep->nodes);
+        scyte_free_exec(rep->forward); scyte_free_exec(rep->backward);
+        free(rep->arena); free(rep->deltas);
+    }
+    free(r->replicas); free(r->threads);
+    free(r);
+}
+
+void scyte_sync_replica_params(scyte_replicas* r)
+{
+    for(int k = 0; k < r->num_replicas; ++k) {
+        scyte_replica* rep = &r->replicas[k];
+        for(int i = 0; i < rep->n; ++i) {
+            copy_params(rep->nodes[i], r->net->nodes[i]);
+        }
+    }
+}
+
+float scyte_run_replicas(scyte_replicas* r, int batch_size, float* X, float* y, int calc_grads)
+{
+    r->batch_size = batch_size, r->calc_grads = calc_grads;
+    r->X = X, r->y = y;
+#ifdef _OPENMP
+    int num_omp_threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+    pthread_barrier_wait(&r->barrier);
+    run_step(r, 0);
+    pthread_barrier_wait(&r->barrier);
+#ifdef _OPENMP
+    omp_set_num_threads(num_omp_threads);
+#endif
+    float cost = 0.f;
+    for(int k = 0; k < r->num_replicas; ++k) {
+        scyte_replica* rep = &r->replicas[k];
+        cost += rep->num_samples*rep->cost;
+    }
+    return cost / batch_size;
+}
@@ -0,0 +1,64 @@
+#include "sampler.h"
+
+#include "logger.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+scyte_sampler* scyte_make_sampler(int n, const int* indices, int shuffle, uint64_t seed)
+{
+    if(n <= 0) {
+        LOG_ERRORF("couldn't make sampler over %d indices", n);
+        return NULL;
+    }
+    scyte_sampler* s = (scyte_sampler*)calloc(1, sizeof(scyte_sampler));
+    s->n = n, s->shuffle = shuffle, s->seed = seed;
+    s->pool = (int*)malloc(n*sizeof(int));
+    s->order = (int*)malloc(n*sizeof(int));
+    for(int i = 0; i < n; ++i) s->pool[i] = indices ? indices[i] : i;
+    s->num_shards = 1;
+    scyte_set_sampler_epoch(s, 0);
+    return s;
+}
+
+void scyte_free_sampler(scyte_sampler* s)
+{
+    if(!s) return;
+    free(s->pool); free(s->order);
+    free(s);
+}
+
+void scyte_shard_sampler(scyte_sampler* s, int shard, int num_shards, int strided)
+{
+    if(num_shards < 1 || shard < 0 || shard >= num_shards || num_shards > s->n) {
+        LOG_ERRORF("couldn't shard sampler of %d indices into shard %d of %d", s->n, shard, num_shards);
+        return;
+    }
+    s->shard = shard, s->num_shards = num_shards, s->strided = strided;
+    s->pos = 0;
+}
+
+void scyte_set_sampler_epoch(scyte_sampler* s, int epoch)
+{
+    s->epoch = epoch, s->pos = 0;
+    memcpy(s->order, s->pool, s->n*sizeof(int));
+    if(s->shuffle) {
+        scyte_rng rng;
+        scyte_rng_seed(&rng, s->seed + 0x9e3779b97f4a7c15ULL*(uint64_t)epoch);
+        scyte_rng_shuffle(&rng, s->n, s->order);
+    }
+}
+
+int scyte_sampler_epoch_size(const scyte_sampler* s)
+{
+    if(s->strided) return (s->n - s->shard + s->num_shards - 1) / s->num_shards;
+    return (int)((long)(s->shard + 1)*s->n/s->num_shards - (long)s->shard*s->n/s->num_shards);
+}
+
+int scyte_sampler_next(scyte_sampler* s)
+{
+    if(s->pos >= scyte_sampler_epoch_size(s)) scyte_set_sampler_epoch(s, s->epoch + 1);
+    int pos = s->pos++;
+    if(s->strided) return s->order[s->shard + pos*s->num_shards];
+    return s->order[(long)s->shard*s->n/s->num_shards + pos];
+}
@@ -0,0 +1,383 @@
+#include "scheduler.h"
+
+#include "blas.h"
+#include "logger.h"
+#include "op.h"
+#include "random.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// memory read or written by a step
+typedef struct {
+    const float* start, *end;
+    int written;
+} mem_range;
+
+struct scyte_exec_deps {
+    int num_steps;
+    mem_range* ranges;  // the memory of every step when the dependencies were computed
+    int* range_start;   // first range of each step, and one past the last
+    int* num_deps;      // number of steps each step waits for
+    int* succ_start;    // first successor of each step, and one past the last
+    int* succs;         // steps that wait for each step
+    int* cleared_start; // first node of plan->cleared of each step
+};
+
+// the ready steps of a thread, it takes the last one, thieves take the first one
+typedef struct {
+    pthread_mutex_t lock;
+    int head, tail;
+    int* steps;
+} step_queue;
+
+struct scyte_scheduler {
+    int num_threads;
+    pthread_t* threads;     // workers 1..num_threads-1, 0 is the caller
+    pthread_barrier_t barrier;
+    int stop;
+    step_queue* queues;
+    int capacity;           // steps every queue and pending have room for
+    // the plan being run
+    scyte_exec_plan* plan;
+    int* pending;           // number of steps each step still waits for
+    int num_done;
+    // threads that find no step for a while sleep until one is pushed, see wait_for_steps
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle;
+    int num_idle, wakeups;
+    uint64_t seed;          // step k draws from the stream seed + k, seed is drawn from the caller's
+};
+
+static inline void add_range(mem_range* ranges, int* n, const float* start, int size, int written)
+{
+    if(!start) return;
+    ranges[(*n)++] = (mem_range){ start, start + size, written };
+}
+
+static int max_num_ranges(const scyte_exec_plan* plan)
+{
+    int n = 0;
+    for(int k = 0; k < plan->num_steps; ++k) n += 2 + 2*plan->steps[k].node->num_children + plan->steps[k].num_cleared;
+    return n;
+}
+
+// forward steps read their children and write their values, backward steps read the values of
+// their node and children, update the node's delta in place and accumulate into their children's
+// (see scyte_backprops_into), after clearing the deltas they're the first to accumulate into
+static int collect_ranges(const scyte_exec_plan* plan, mem_range* ranges, int* range_start)
+{
+    int n = 0;
+    scyte_node** cleared = plan->cleared;
+    for(int k = 0; k < plan->num_steps; ++k) {
+        scyte_node* node = plan->steps[k].node;
+        range_start[k] = n;
+        add_range(ranges, &n, node->vals, scyte_num_elements(node), !plan->backward);
+        if(plan->backward) add_range(ranges, &n, node->delta, scyte_num_elements(node), 1);
+        for(int j = 0; j < node->num_children; ++j) {
+            scyte_node* child = node->children[j];
+            int size = scyte_span(child);
+            add_range(ranges, &n, child->vals, size, 0);
+            if(plan->backward && scyte_has_gradient(child) && scyte_backprops_into(node, j)) add_range(ranges, &n, child->delta, size, 1);
+        }
+        for(int j = 0; j < plan->steps[k].num_cleared; ++j, ++cleared) {
+            add_range(ranges, &n, (*cleared)->delta, scyte_num_elements(*cleared), 1);
+        }
+    }
+    range_start[plan->num_steps] = n;
+    return n;
+}
+
+static int conflicts(const mem_range* a, int num_a, const mem_range* b, int num_b)
+{
+    for(int i = 0; i < num_a; ++i) {
+        for(int j = 0; j < num_b; ++j) {
+            if(!a[i].written && !b[j].written) continue;
+            if(a[i].start < b[j].end && b[j].start < a[i].end) return 1;
+        }
+    }
+    return 0;
+}
+
+// step j depends on every earlier step i it conflicts with
+static void compute_deps(scyte_exec_deps* deps)
+{
+    int n = deps->num_steps, num_edges = 0, capacity = n;
+    int* edges = (int*)malloc(2*capacity*sizeof(int));
+    memset(deps->num_deps, 0, n*sizeof(int));
+    memset(deps->succ_start, 0, (n + 1)*sizeof(int));
+    for(int j = 0; j < n; ++j) {
+        const mem_range* rj = deps->ranges + deps->range_start[j];
+        int num_rj = deps->range_start[j + 1] - deps->range_start[j];
+        for(int i = 0; i < j; ++i) {
+            const mem_range* ri = deps->ranges + deps->range_start[i];
+            if(!conflicts(ri, deps->range_start[i + 1] - deps->range_start[i], rj, num_rj)) continue;
+            if(num_edges == capacity) {
+                capacity *= 2;
+                edges = (int*)realloc(edges, 2*capacity*sizeof(int));
+            }
+            edges[2*num_edges] = i, edges[2*num_edges + 1] = j;
+            num_edges++;
+            deps->num_deps[j]++, deps->succ_start[i + 1]++;
+        }
+    }
+    for(int i = 0; i < n; ++i) deps->succ_start[i + 1] += deps->succ_start[i];
+    // the edges are sorted by their second step, so every step's successors stay in order
+    deps->succs = (int*)realloc(deps->succs, (num_edges > 0 ? num_edges : 1)*sizeof(int));
+    int* fill = (int*)malloc(n*sizeof(int));
+    memcpy(fill, deps->succ_start, n*sizeof(int));
+    for(int e = 0; e < num_edges; ++e) deps->succs[fill[edges[2*e]]++] = edges[2*e + 1];
+    free(fill); free(edges);
+}
+
+static scyte_exec_deps* make_deps(const scyte_exec_plan* plan)
+{
+    int n = plan->num_steps;
+    scyte_exec_deps* deps = (scyte_exec_deps*)calloc(1, sizeof(scyte_exec_deps));
+    deps->num_steps = n;
+    deps->ranges = (mem_range*)malloc((max_num_ranges(plan) + 1)*sizeof(mem_range));
+    deps->range_start = (int*)malloc((n + 1)*sizeof(int));
+    deps->num_deps = (int*)malloc((n + 1)*sizeof(int));
+    deps->succ_start = (int*)malloc((n + 1)*sizeof(int));
+    deps->cleared_start = (int*)malloc((n + 1)*sizeof(int));
+    deps->cleared_start[0] = 0;
+    for(int k = 0; k < n; ++k) deps->cleared_start[k + 1] = deps->cleared_start[k] + plan->steps[k].num_cleared;
+    collect_ranges(plan, deps->ranges, deps->range_start);
+    compute_deps(deps);
+    return deps;
+}
+
+void scyte_free_exec_deps(scyte_exec_deps* deps)
+{
+    if(!deps) return;
+    free(deps->ranges); free(deps->range_start);
+    free(deps->num_deps); free(deps->succ_start); free(deps->succs);
+    free(deps->cleared_start);
+    free(deps);
+}
+
+// the dependencies of the plan for the memory its nodes are bound to now
+static scyte_exec_deps* get_deps(scyte_exec_plan* plan)
+{
+    scyte_exec_deps* deps = plan->deps;
+    if(!deps) return plan->deps = make_deps(plan);
+    int num_ranges = deps->range_start[deps->num_steps];
+    mem_range* ranges = (mem_range*)malloc((max_num_ranges(plan) + 1)*sizeof(mem_range));
+    int* range_start = (int*)malloc((deps->num_steps + 1)*sizeof(int));
+    int moved = collect_ranges(plan, ranges, range_start) != num_ranges;
+    for(int i = 0; !moved && i < num_ranges; ++i) {
+        moved = ranges[i].start != deps->ranges[i].start || ranges[i].end != deps->ranges[i].end;
+    }
+    if(moved) {
+        free(deps->ranges); free(deps->range_start);
+        deps->ranges = ranges, deps->range_start = range_start;
+        compute_deps(deps);
+        return deps;
+    }
+    free(ranges); free(range_start);
+    return deps;
+}
+
+static void push_step(step_queue* q, int k)
+{
+    pthread_mutex_lock(&q->lock);
+    q->steps[q->tail++] = k;
+    pthread_mutex_unlock(&q->lock);
+}
+
+// takes the newest step of the thread's own queue, or else the oldest one of another's
+static int pop_step(scyte_scheduler* s, int id)
+{
+    int k = -1;
+    step_queue* q = &s->queues[id];
+    pthread_mutex_lock(&q->lock);
+    if(q->tail > q->head) k = q->steps[--q->tail];
+    pthread_mutex_unlock(&q->lock);
+    for(int i = 1; k < 0 && i < s->num_threads; ++i) {
+        q = &s->queues[(id + i) % s->num_threads];
+        pthread_mutex_lock(&q->lock);
+        if(q->tail > q->head) k = q->steps[q->head++];
+        pthread_mutex_unlock(&q->lock);
+    }
+    return k;
+}
+
+static void run_step(const scyte_exec_plan* plan, const scyte_exec_deps* deps, int k, uint64_t seed)
+{
+    const scyte_exec_step* step = &plan->steps[k];
+    for(int j = deps->cleared_start[k]; j < deps->cleared_start[k + 1]; ++j) {
+        scyte_node* cleared = plan->cleared[j];
+        if(cleared->delta) set_cpu(scyte_num_elements(cleared), 0, cleared->delta);
+    }
+    // whichever thread runs the step, e.g. a dropout draws the same numbers
+    scyte_rng rng;
+    scyte_rng_seed(&rng, seed + k);
+    scyte_rng* prev = scyte_swap_thread_rng(&rng);
+    step->run(step->node);
+    scyte_swap_thread_rng(prev);
+}
+
+static int has_steps(scyte_scheduler* s)
+{
+    int found = 0;
+    for(int i = 0; !found && i < s->num_threads; ++i) {
+        pthread_mutex_lock(&s->queues[i].lock);
+        found = s->queues[i].tail > s->queues[i].head;
+        pthread_mutex_unlock(&s->queues[i].lock);
+    }
+    return found;
+}
+
+// Sleeps until a step is pushed or the plan is done. The thread counts itself idle before it looks
+// at the queues, and a pusher looks at the count after pushing, so either the thread sees the step
+// or the pusher sees the thread and wakes it
+static void wait_for_steps(scyte_scheduler* s)
+{
+    pthread_mutex_lock(&s->idle_lock);
+    __atomic_add_fetch(&s->num_idle, 1, __ATOMIC_SEQ_CST);
+    int wakeups = s->wakeups;
+    while(wakeups == s->wakeups && !has_steps(s)
+            && __atomic_load_n(&s->num_done, __ATOMIC_SEQ_CST) < s->plan->deps->num_steps) {
+        pthread_cond_wait(&s->idle, &s->idle_lock);
+    }
+    __atomic_sub_fetch(&s->num_idle, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&s->idle_lock);
+}
+
+static void wake_idle(scyte_scheduler* s)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&s->num_idle, __ATOMIC_RELAXED) == 0) return;
+    pthread_mutex_lock(&s->idle_lock);
+    s->wakeups++;
+    pthread_cond_broadcast(&s->idle);
+    pthread_mutex_unlock(&s->idle_lock);
+}
+
+// times a thread looks for a step before it sleeps, the steps of a branch are usually short
+#define SPIN_COUNT 256
+
+static void run_steps(scyte_scheduler* s, int id)
+{
+    const scyte_exec_plan* plan = s->plan;
+    const scyte_exec_deps* deps = plan->deps;
+    int misses = 0;
+    while(__atomic_load_n(&s->num_done, __ATOMIC_ACQUIRE) < deps->num_steps) {
+        int k = pop_step(s, id);
+        if(k < 0) {
+            if(++misses == SPIN_COUNT) wait_for_steps(s), misses = 0;
+            continue;
+        }
+        misses = 0;
+        run_step(plan, deps, k, s->seed);
+        // the last step a successor waits for makes it ready, on this thread's queue
+        int pushed = 0;
+        for(int e = deps->succ_start[k]; e < deps->succ_start[k + 1]; ++e) {
+            int succ = deps->succs[e];
+            if(__atomic_sub_fetch(&s->pending[succ], 1, __ATOMIC_ACQ_REL) == 0) push_step(&s->queues[id], succ), pushed = 1;
+        }
+        // the idle threads wake for the steps pushed, or to return once every step is done
+        if(__atomic_add_fetch(&s->num_done, 1, __ATOMIC_SEQ_CST) == deps->num_steps || pushed) wake_idle(s);
+    }
+}
+
+typedef struct {
+    scyte_scheduler* s;
+    int id;
+} worker_args;
+
+static void* worker_loop(void* arg)
+{
+    worker_args args = *(worker_args*)arg;
+    free(arg);
+#ifdef _OPENMP
+    omp_set_num_threads(1); // the branches already keep the cores busy
+#endif
+    for(;;) {
+        pthread_barrier_wait(&args.s->barrier);
+        if(args.s->stop) break;
+        run_steps(args.s, args.id);
+        pthread_barrier_wait(&args.s->barrier);
+    }
+    return NULL;
+}
+
+scyte_scheduler* scyte_make_scheduler(int num_threads)
+{
+    if(num_threads < 1) {
+        LOG_ERRORF("couldn't make a scheduler of %d threads", num_threads);
+        return NULL;
+    }
+    scyte_scheduler* s = (scyte_scheduler*)calloc(1, sizeof(scyte_scheduler));
+    s->num_threads = num_threads;
+    s->queues = (step_queue*)calloc(num_threads, sizeof(step_queue));
+    for(int i = 0; i < num_threads; ++i) pthread_mutex_init(&s->queues[i].lock, NULL);
+    pthread_barrier_init(&s->barrier, NULL, num_threads);
+    pthread_mutex_init(&s->idle_lock, NULL);
+    pthread_cond_init(&s->idle, NULL);
+    s->threads = (pthread_t*)calloc(num_threads, sizeof(pthread_t));
+    for(int i = 1; i < num_threads; ++i) {
+        worker_args* args = (worker_args*)malloc(sizeof(worker_args));
+        args->s = s, args->id = i;
+        pthread_create(&s->threads[i], NULL, worker_loop, args);
+    }
+    return s;
+}
+
+void scyte_free_scheduler(scyte_scheduler* s)
+{
+    if(!s) return;
+    s->stop = 1;
+    pthread_barrier_wait(&s->barrier);
+    for(int i = 1; i < s->num_threads; ++i) pthread_join(s->threads[i], NULL);
+    pthread_barrier_destroy(&s->barrier);
+    pthread_mutex_destroy(&s->idle_lock);
+    pthread_cond_destroy(&s->idle);
+    for(int i = 0; i < s->num_threads; ++i) {
+        pthread_mutex_destroy(&s->queues[i].lock);
+        free(s->queues[i].steps);
+    }
+    free(s->queues); free(s->threads); free(s->pending);
+    free(s);
+}
+
+const float* scyte_schedule_exec(scyte_scheduler* s, scyte_exec_plan* plan)
+{
+    if(s->num_threads == 1 || plan->num_steps < 2) return scyte_run_exec(plan);
+    // the steps read and write the views' memory as bound for this run
+    scyte_bind_exec_views(plan);
+    scyte_exec_deps* deps = get_deps(plan);
+    int n = plan->num_steps;
+    if(n > s->capacity) {
+        for(int i = 0; i < s->num_threads; ++i) s->queues[i].steps = (int*)realloc(s->queues[i].steps, n*sizeof(int));
+        s->pending = (int*)realloc(s->pending, n*sizeof(int));
+        s->capacity = n;
+    }
+    // the steps without dependencies are dealt out to the threads
+    for(int i = 0; i < s->num_threads; ++i) s->queues[i].head = s->queues[i].tail = 0;
+    for(int k = 0, next = 0; k < n; ++k) {
+        s->pending[k] = deps->num_deps[k];
+        if(s->pending[k] > 0) continue;
+        step_queue* q = &s->queues[next++ % s->num_threads];
+        q->steps[q->tail++] = k;
+    }
+    s->plan = plan, s->num_done = 0;
+    s->seed = scyte_rng_next(scyte_thread_rng());
+    if(plan->backward) plan->target->delta[0] = 1.f;
+
+#ifdef _OPENMP
+    int num_omp_threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+    pthread_barrier_wait(&s->barrier);
+    run_steps(s, 0);
+    pthread_barrier_wait(&s->barrier);
+#ifdef _OPENMP
+    omp_set_num_threads(num_omp_threads);
+#endif
+    return plan->backward ? plan->target->delta : plan->target->vals;
+}
@@ -4,6 +4,7 @@
 #include "blas.h"
 #include "list.h"
 #include "logger.h"
+#include "scheduler.h"
 #include "utils.h"
 
 #include <stdlib.h>
@@ -66,7 +67,7 @@ scyte_node* scyte_weight(int rows, int cols)
     return scyte_var(2, shape, 0.f);
 }
 
-int scyte_find_node(scyte_network* net, scyte_node_type type)
+int scyte_find_node(const scyte_network* net, scyte_node_type type)
 {
     int idx = -1, num_matches = 0;
     for(int i = 0; i < net->n; ++i) {
@@ -113,12 +114,36 @@ static inline void scyte_propagate_gradient_marks(int n, scyte_node** nodes)
     }
 }
 
+void scyte_sync_views(int n, scyte_node** nodes)
+{
+    for(int i = 0; i < n; ++i) {
+        scyte_node* node = nodes[i];
+        if(scyte_is_operand(node) || node->op_type != TRANSPOSE) continue;
+        int was_view = scyte_is_view(node);
+        // the strides of the view are what its consumers would read
+        scyte_set_transpose_packed(node, 0);
+        int view = scyte_is_contiguous(node) || !(node->type & (OUTPUT | COST));
+        for(int j = i + 1; j < n && view; ++j) {
+            for(int k = 0; k < nodes[j]->num_children; ++k) {
+                if(nodes[j]->children[k] == node && !scyte_reads_strided(nodes[j], k)) view = scyte_is_contiguous(node);
+            }
+        }
+        scyte_set_transpose_packed(node, !view);
+        if(was_view && !view) node->vals = node->delta = NULL;
+        else if(!was_view && view) {
+            free(node->vals), free(node->delta);
+            node->vals = node->delta = NULL;
+        }
+    }
+}
+
 static void scyte_allocate_op_nodes(int n, scyte_node** nodes)
 {
     scyte_propagate_gradient_marks(n, nodes);
+    scyte_sync_views(n, nodes);
     for(int i = 0; i < n; ++i) {
         scyte_node* node = nodes[i];
-        if(scyte_is_operand(node)) continue;
+        if(scyte_is_operand(node) || scyte_is_view(node)) continue;
         int num_elements = scyte_num_elements(node);
         node->vals = (float*)realloc(node->vals, num_elements*sizeof(float));
         if(scyte_has_gradient(node)) {
@@ -127,7 +152,7 @@ static void scyte_allocate_op_nodes(int n, scyte_node** nodes)
     }
 }
 
-void scyte_set_batch_size(int n, scyte_node** nodes, int batch_size)
+int scyte_resync_batch_size(int n, scyte_node** nodes, int batch_size)
 {
     int old_batch_size = batch_size, need_resync = 0;
     for(int i = 0; i < n; ++i) {
@@ -140,8 +165,16 @@ void scyte_set_batch_size(int n, scyte_node** nodes, int batch_size)
         }
         else if(!scyte_is_operand(node) && need_resync) scyte_get_resync_function(node->op_type)(node);
     }
+    return old_batch_size;
+}
+
+void scyte_set_batch_size(int n, scyte_node** nodes, int batch_size)
+{
+    int old_batch_size = scyte_resync_batch_size(n, nodes, batch_size);
     int need_alloc = old_batch_size < batch_size;
-    for(int i = 0; i < n; ++i) if(!scyte_is_operand(nodes[i]) && !nodes[i]->vals) need_alloc = 1;
+    for(int i = 0; i < n; ++i) {
+        if(!scyte_is_operand(nodes[i]) && !scyte_is_view(nodes[i]) && !nodes[i]->vals) need_alloc = 1;
+    }
     if(need_alloc) scyte_allocate_op_nodes(n, nodes);
 }
 
@@ -199,28 +232,88 @@ scyte_node** scyte_make_graph(int* num_nodes, int num_roots, scyte_node** roots)
     *num_nodes = out->size;
     scyte_allocate_op_nodes(*num_nodes, graph);
 
-    free_list(l);
+    free_list(l); free_list(out);
     return graph;
 }
 
 void scyte_free_graph(int n, scyte_node** nodes)
 {
+    // whether a select is a view depends on its children, which are freed before it
+    char* owns_buffers = (char*)calloc(n, 1);
+    for(int i = 0; i < n; ++i) owns_buffers[i] = nodes[i] && !scyte_is_operand(nodes[i]) && !scyte_is_view(nodes[i]);
     for(int i = 0; i < n; ++i) {
         scyte_node* node = nodes[i];
         if(!node) continue;
-        if(!scyte_is_operand(node)) free(node->vals), free(node->delta);
+        if(owns_buffers[i]) free(node->vals), free(node->delta);
         free(node->tmp); free(node->params);
         free(node->children); free(node);
     }
+    free(owns_buffers);
     free(nodes);
 }
 
+scyte_node** scyte_copy_graph(int n, scyte_node** nodes, int batch_size)
+{
+    scyte_node** copy = (scyte_node**)calloc(n, sizeof(scyte_node*));
+    for(int i = 0; i < n; ++i) {
+        scyte_node* src = nodes[i];
+        scyte_node* node = (scyte_node*)calloc(1, sizeof(scyte_node));
+        node->type = src->type, node->op_type = src->op_type;
+        node->forward = src->forward, node->backward = src->backward;
+        scyte_copy_shape(src, node);
+        if(scyte_is_var(src) || scyte_is_const(src)) node->vals = src->vals;
+        else if(scyte_is_placeholder(src)) node->shape[0] = batch_size;
+        if(src->num_children > 0) {
+            node->num_children = src->num_children;
+            node->children = (scyte_node**)calloc(src->num_children, sizeof(scyte_node*));
+            // children are looked up rather than marked, so that the original isn't written to
+            // and can be copied from several threads. they are always sorted before their parents
+            for(int j = 0; j < src->num_children; ++j) {
+                int k = i - 1;
+                while(nodes[k] != src->children[j]) --k;
+                node->children[j] = copy[k];
+            }
+            if(src->params_size > 0) {
+                node->params = malloc(src->params_size);
+                memcpy(node->params, src->params, src->params_size);
+                node->params_size = src->params_size;
+            }
+            // syncs the dims to the new batch size and allocates the scratch buffers
+            scyte_get_resync_function(node->op_type)(node);
+        }
+        copy[i] = node;
+    }
+    scyte_allocate_op_nodes(n, copy);
+    return copy;
+}
+
 void scyte_copy_shape(const scyte_node* src, scyte_node* dst)
 {
-    dst->num_dims = src->num_dims;
+    dst->num_dims = src->num_dims, dst->layout = src->layout;
     if(src->num_dims){
         memcpy(dst->shape, src->shape, src->num_dims*sizeof(int));
     }
+    memset(dst->strides, 0, sizeof(dst->strides));
+}
+
+void scyte_get_strides(const scyte_node* node, int strides[SCYTE_MAX_DIMS])
+{
+    if(!scyte_is_contiguous(node)) {
+        memcpy(strides, node->strides, node->num_dims*sizeof(int));
+        return;
+    }
+    for(int i = node->num_dims - 1, stride = 1; i >= 0; --i) {
+        strides[i] = stride;
+        stride *= node->shape[i];
+    }
+}
+
+int scyte_span(const scyte_node* node)
+{
+    if(scyte_is_contiguous(node)) return scyte_num_elements((scyte_node*)node);
+    int span = 1;
+    for(int i = 0; i < node->num_dims; ++i) span += (node->shape[i] - 1)*node->strides[i];
+    return span;
 }
 
 void scyte_fill_vals(scyte_node* node, float fill_val)
@@ -231,12 +324,14 @@ void scyte_fill_vals(scyte_node* node, float fill_val)
     }
 }
 
-static inline void scyte_propagate_marks(int n, scyte_node** nodes)
+// marks the nodes the marked ones depend on, or only those gradients flow into when backward
+static inline void scyte_propagate_marks(int n, scyte_node** nodes, int backward)
 {
     for(int i = n-1; i>= 0; --i) {
         scyte_node* node = nodes[i];
         if(node->mark > 0) {
             for(int j = 0; j < node->num_children; ++j) {
+                if(backward && !scyte_backprops_into(node, j)) continue;
                 node->children[j]->mark = (node->children[j]->mark == 0)
                                             ? 1 : node->children[j]->mark;
             }
@@ -244,12 +339,30 @@ static inline void scyte_propagate_marks(int n, scyte_node** nodes)
     }
 }
 
+// Marks the nodes whose deltas are accumulated into for the first time through child, and adds
+// them to cleared: the child itself, or the nodes a view's delta aliases. Views never accumulate
+// into their children themselves, so the first consumer of any alias clears the whole delta
+static int mark_first_accumulation(scyte_node* child, scyte_node** cleared)
+{
+    if(scyte_is_view(child)) {
+        int num_cleared = 0;
+        for(int j = 0; j < child->num_children; ++j) {
+            num_cleared += mark_first_accumulation(child->children[j], cleared + num_cleared);
+        }
+        return num_cleared;
+    }
+    if(!scyte_has_gradient(child) || child->mark != 1) return 0;
+    child->mark = 2;
+    *cleared = child;
+    return 1;
+}
+
 const float* scyte_forward(int n, scyte_node** nodes, int to)
 {
     int i;
     if(to < 0 || to >= n) to = n - 1;
     for(i = 0; i < n; ++i) nodes[i]->mark = (i == to);
-    scyte_propagate_marks(n, nodes);
+    scyte_propagate_marks(n, nodes, 0);
     for(i = 0; i < n; ++i) {
         scyte_node* node = nodes[i];
         if(node->num_children > 0 && node->mark > 0) {
@@ -267,27 +380,102 @@ void scyte_backward(int n, scyte_node** nodes, int from)
 
     // mark nodes where gradients should flow through
     for(i = 0; i < n; ++i) nodes[i]->mark = (i == from);
-    scyte_propagate_marks(n, nodes);
-
-    // set all relevant gradients to 0
-    for(i = 0; i <= from; ++i) {
-        scyte_node* node = nodes[i];
-        if(node->delta && node->mark > 0) {
-            set_cpu(scyte_num_elements(node), 0, node->delta);
-        }
-    }
+    scyte_propagate_marks(n, nodes, 1);
 
     //backprop
     nodes[from]->delta[0] = 1.f; // derivative of output w.r.t output is 1
+    scyte_node** cleared = (scyte_node**)malloc(n*sizeof(scyte_node*));
     for(i = from; i >= 0; --i) {
         scyte_node* node = nodes[i];
-        if(node->num_children > 0 && node->mark > 0) {
+        if(node->num_children > 0 && node->mark > 0 && !scyte_is_view(node)) {
+            // gradients are zeroed right before they are first accumulated into (mark 2), so
+            // that memory planned deltas only have to be alive from their first parent and on
+            for(int j = 0; j < node->num_children; ++j) {
+                if(!scyte_backprops_into(node, j)) continue;
+                int num_cleared = mark_first_accumulation(node->children[j], cleared);
+                for(int k = 0; k < num_cleared; ++k) {
+                    if(cleared[k]->delta) set_cpu(scyte_num_elements(cleared[k]), 0, cleared[k]->delta);
+                }
+            }
             node->backward(node);
         }
     }
+    free(cleared);
     for(i = 0; i <= from; ++i) nodes[i]->mark = 0;
 }
 
+scyte_exec_plan* scyte_compile_exec(int n, scyte_node** nodes, int target, int backward)
+{
+    if(target < 0 || target >= n) target = n - 1;
+    assert(!backward || nodes[target]->num_dims == 0);
+    for(int i = 0; i < n; ++i) nodes[i]->mark = (i == target);
+    scyte_propagate_marks(n, nodes, backward);
+
+    scyte_exec_plan* plan = (scyte_exec_plan*)calloc(1, sizeof(scyte_exec_plan));
+    plan->backward = backward, plan->target = nodes[target];
+    plan->steps = (scyte_exec_step*)malloc(n*sizeof(scyte_exec_step));
+    plan->views = (scyte_node**)malloc(n*sizeof(scyte_node*));
+    for(int i = 0; i <= target; ++i) {
+        if(scyte_is_view(nodes[i]) && nodes[i]->mark) plan->views[plan->num_views++] = nodes[i];
+    }
+    if(!backward) {
+        for(int i = 0; i <= target; ++i) {
+            scyte_node* node = nodes[i];
+            if(node->num_children == 0 || node->mark == 0 || scyte_is_view(node)) continue;
+            plan->steps[plan->num_steps++] = (scyte_exec_step){ node->forward, node, 0 };
+        }
+    }
+    else {
+        int num_cleared = 0;
+        plan->cleared = (scyte_node**)malloc(n*sizeof(scyte_node*));
+        for(int i = target; i >= 0; --i) {
+            scyte_node* node = nodes[i];
+            if(node->num_children == 0 || node->mark == 0 || !scyte_has_gradient(node) || scyte_is_view(node)) continue;
+            scyte_exec_step* step = &plan->steps[plan->num_steps++];
+            *step = (scyte_exec_step){ node->backward, node, 0 };
+            for(int j = 0; j < node->num_children; ++j) {
+                if(!scyte_backprops_into(node, j)) continue;
+                step->num_cleared += mark_first_accumulation(node->children[j], plan->cleared + num_cleared + step->num_cleared);
+            }
+            num_cleared += step->num_cleared;
+        }
+    }
+    for(int i = 0; i < n; ++i) nodes[i]->mark = 0;
+    return plan;
+}
+
+void scyte_bind_exec_views(const scyte_exec_plan* plan)
+{
+    for(int i = 0; i < plan->num_views; ++i) plan->views[i]->forward(plan->views[i]);
+}
+
+const float* scyte_run_exec(const scyte_exec_plan* plan)
+{
+    const scyte_exec_step* step = plan->steps, *end = plan->steps + plan->num_steps;
+    scyte_bind_exec_views(plan);
+    if(!plan->backward) {
+        for(; step < end; ++step) step->run(step->node);
+        return plan->target->vals;
+    }
+    scyte_node** cleared = plan->cleared;
+    plan->target->delta[0] = 1.f;
+    for(; step < end; ++step) {
+        for(int j = 0; j < step->num_cleared; ++j, ++cleared) {
+            if((*cleared)->delta) set_cpu(scyte_num_elements(*cleared), 0, (*cleared)->delta);
+        }
+        step->run(step->node);
+    }
+    return plan->target->delta;
+}
+
+void scyte_free_exec(scyte_exec_plan* plan)
+{
+    if(!plan) return;
+    free(plan->steps); free(plan->cleared); free(plan->views);
+    scyte_free_exec_deps(plan->deps);
+    free(plan);
+}
+
 static inline const char* get_node_type_str(scyte_node* node)
 {
     if(scyte_is_var(node)) return "var";
@@ -395,6 +583,10 @@ scyte_node** scyte_load_graph(FILE* fp, int* n)
         graph[i] = scyte_load_node(fp, graph);
     }
     *n = num_nodes;
+    // the layouts and scratch buffers of the op-nodes aren't saved, they are derived from the children
+    for(int i = 0; i < num_nodes; ++i) {
+        if(!scyte_is_operand(graph[i])) scyte_get_resync_function(graph[i]->op_type)(graph[i]);
+    }
     scyte_propagate_gradient_marks(num_nodes, graph);
     scyte_allocate_op_nodes(*n, graph);
     return graph;
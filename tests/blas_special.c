@@ -0,0 +1,126 @@
+// The vectorized math kernels of every instruction set the host supports on special values: NaN,
+// infinities, signed zeros, denormals and the edges of the polynomials' ranges. They must agree
+// with libm, within a few ulp where the result is a normal number, and give the same results in
+// every build
+#include "blas_kernels.h"
+
+#include <float.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+// every value is repeated over a vector body and a scalar tail
+#define N 37
+#define MAX_ULP 8.0
+
+typedef struct {
+    const char* name;
+    size_t offset;
+    double (*ref)(double);
+} kernel;
+
+static double sigmoid_ref(double x) { return 1.0/(1.0 + exp(-x)); }
+
+static const kernel kernel_list[] = {
+    { "exp", offsetof(blas_kernels, exp), exp },
+    { "log", offsetof(blas_kernels, log), log },
+    { "tanh", offsetof(blas_kernels, tanh), tanh },
+    { "sigmoid", offsetof(blas_kernels, sigmoid), sigmoid_ref },
+    { "sin", offsetof(blas_kernels, sin), sin },
+    { "cos", offsetof(blas_kernels, cos), cos },
+};
+
+static int bits_of(float x)
+{
+    int i;
+    memcpy(&i, &x, sizeof(i));
+    return i;
+}
+
+// on the bits, -Ofast folds isnan and isinf
+static int is_nan(float x)
+{
+    return (bits_of(x) & 0x7fffffff) > 0x7f800000;
+}
+
+static int is_inf(float x)
+{
+    return (bits_of(x) & 0x7fffffff) == 0x7f800000;
+}
+
+static int same(float a, float b)
+{
+    return (is_nan(a) && is_nan(b)) || bits_of(a) == bits_of(b);
+}
+
+// the exact value of x, converting a denormal to a double flushes it to 0 under -Ofast
+static double to_double(float x)
+{
+    int bits = bits_of(x), mantissa = bits & 0x7fffff;
+    if(bits & 0x7f800000) return x;
+    return bits < 0 ? -ldexp(mantissa, -149) : ldexp(mantissa, -149);
+}
+
+// whether y is what the kernel should give, special results exactly and the others within
+// MAX_ULP of libm
+static int check(float y, double ref)
+{
+    int y_bits = bits_of(y);
+    if(is_nan((float)ref)) return is_nan(y);
+    if(is_nan(y)) return 0;
+    if(is_inf((float)ref)) return y_bits == bits_of((float)ref);
+    // denormals are flushed to zeros of their sign, zeros keep theirs through the odd functions
+    if(fabs(ref) < FLT_MIN) return (y_bits & 0x7fffffff) == 0 && (y_bits < 0) == (bits_of((float)ref) < 0);
+    double ulp = ldexp(1.0, ilogb(ref) - 23);
+    return fabs(y - ref) <= MAX_ULP*ulp;
+}
+
+// results that are the limits of the functions, or whose inputs are NaN, infinite, zero or denormal,
+// must be the same in every build
+static int is_special(float x, double ref)
+{
+    return (bits_of(x) & 0x7f800000) == 0 || (bits_of(x) & 0x7f800000) == 0x7f800000 || fabs(ref) < FLT_MIN
+        || fabs(ref) == 1.0 || is_inf((float)ref);
+}
+
+int main()
+{
+    const float inputs[] = {
+        NAN, -NAN, INFINITY, -INFINITY, 0.f, -0.f, FLT_TRUE_MIN, -FLT_TRUE_MIN, 1e-40f, -1e-40f,
+        FLT_MIN, -FLT_MIN, 1.f, -1.f, 0.625f, -0.625f, 9.f, 9.5f, -9.5f, 17.4f, 88.f, -87.f, -87.5f,
+        88.72f, 88.73f, -87.33f, -87.34f, -103.f, -104.f, 256.f, -256.f, 257.f, 1e10f, -1e10f, FLT_MAX, -FLT_MAX,
+    };
+    const int num_inputs = sizeof(inputs)/sizeof(inputs[0]);
+    const blas_kernels* isas[4] = { &blas_kernels_generic };
+    int num_isas = 1, failures = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("sse4.2")) isas[num_isas++] = &blas_kernels_sse42;
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) isas[num_isas++] = &blas_kernels_avx2;
+    if(__builtin_cpu_supports("avx512f")) isas[num_isas++] = &blas_kernels_avx512;
+#endif
+    for(size_t k = 0; k < sizeof(kernel_list)/sizeof(kernel_list[0]); ++k) {
+        const kernel* kern = &kernel_list[k];
+        for(int i = 0; i < num_inputs; ++i) {
+            float x[N], y[4][N];
+            for(int j = 0; j < N; ++j) x[j] = inputs[i];
+            for(int a = 0; a < num_isas; ++a) {
+                void (*fn)(int, const float*, float*);
+                memcpy(&fn, (const char*)isas[a] + kern->offset, sizeof(fn));
+                fn(N, x, y[a]);
+                for(int j = 0; j < N; ++j) {
+                    double ref = kern->ref(to_double(x[j]));
+                    int ok = check(y[a][j], ref) && (!is_special(x[j], ref) || same(y[a][j], y[0][j]));
+                    if(ok) continue;
+                    printf("%s %s(%a) = %a at %d, expected %a, generic gives %a\n", isas[a]->name, kern->name,
+                            to_double(x[j]), to_double(y[a][j]), j, ref, to_double(y[0][j]));
+                    failures++;
+                    break;
+                }
+            }
+        }
+    }
+    printf("%d isas, %d failures\n", num_isas, failures);
+    return failures != 0;
+}
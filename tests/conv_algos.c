@@ -0,0 +1,91 @@
+// Every convolution algorithm in every layout gives the cost and the gradients of the weights of
+// im2col and gemm in NCHW, over filter sizes, strides and paddings with pooling in between. The
+// algorithms that don't support a convolution's filter size or stride leave it to the gemm
+#include "network.h"
+#include "layout.h"
+#include "utils.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BATCH 3
+#define CHANNELS 16
+#define WIDTH 13
+#define HEIGHT 11
+#define CLASSES 5
+#define TOLERANCE 1e-5
+
+// the same weights for every network
+static scyte_network* make_net()
+{
+    srand(7);
+    scyte_node* t = scyte_layer_input_image(WIDTH, HEIGHT, CHANNELS);
+    t = scyte_relu(scyte_layer_conv2d(t, 16, 3, 1, 1));
+    t = scyte_relu(scyte_layer_conv2d(t, 16, 3, 1, 0));
+    t = scyte_layer_maxpool2d(t, 2, 2, 0);
+    scyte_node* a = scyte_relu(scyte_layer_conv2d(t, 16, 3, 1, 1));
+    scyte_node* b = scyte_layer_conv2d(t, 16, 1, 1, 0);
+    t = scyte_tanh(scyte_add(a, b));
+    t = scyte_layer_conv2d(t, 32, 3, 2, 1);
+    t = scyte_layer_avgpool2d(t, 3, 2, 1);
+    return scyte_make_network(scyte_layer_cost(t, CLASSES, COST_CROSS_ENTROPY));
+}
+
+static float run(scyte_conv_algo algo, scyte_layout layout, float* X, float* y, float** deltas, int* num_vars)
+{
+    scyte_network* net = make_net();
+    scyte_set_network_layout(net, layout);
+    for(int i = 0; i < net->n; ++i) {
+        scyte_node* node = net->nodes[i];
+        if(scyte_is_operand(node) || node->op_type != CONV2D) continue;
+        int* params = (int*)node->params; // filter size and stride
+        scyte_set_conv_algo(node, scyte_conv_algo_supported(algo, params[0], params[1]) ? algo : SCYTE_CONV_GEMM);
+    }
+    scyte_set_network_batch_size(net, BATCH, SCYTE_PLAN_TRAIN);
+    scyte_feed_net(net, INPUT, &X);
+    scyte_feed_net(net, GROUND_TRUTH, &y);
+    int cost_idx = scyte_find_node(net, COST);
+    float cost = *scyte_forward(net->n, net->nodes, cost_idx);
+    scyte_backward(net->n, net->nodes, cost_idx);
+    *num_vars = 0;
+    for(int i = 0; i < net->n; ++i) {
+        if(scyte_is_var(net->nodes[i])) *num_vars += scyte_num_elements(net->nodes[i]);
+    }
+    *deltas = (float*)malloc(*num_vars*sizeof(float));
+    memcpy(*deltas, net->deltas, *num_vars*sizeof(float));
+    scyte_free_network(net);
+    return cost;
+}
+
+int main()
+{
+    const scyte_conv_algo algos[] = { SCYTE_CONV_GEMM, SCYTE_CONV_DIRECT, SCYTE_CONV_WINOGRAD_2X2, SCYTE_CONV_WINOGRAD_4X4 };
+    const scyte_layout layouts[] = { SCYTE_NCHW, SCYTE_NHWC, SCYTE_NCHW8C, SCYTE_NCHW16C };
+    int in = CHANNELS*HEIGHT*WIDTH, failures = 0;
+    float* X = (float*)malloc(BATCH*in*sizeof(float)), *y = (float*)calloc(BATCH*CLASSES, sizeof(float));
+    srand(1);
+    for(int i = 0; i < BATCH*in; ++i) X[i] = random_uniform(-1.f, 1.f);
+    for(int i = 0; i < BATCH; ++i) y[i*CLASSES + i % CLASSES] = 1.f;
+
+    float* ref_deltas;
+    int num_vars;
+    float ref_cost = run(SCYTE_CONV_GEMM, SCYTE_NCHW, X, y, &ref_deltas, &num_vars);
+    for(int a = 0; a < 4; ++a) {
+        for(int l = 0; l < 4; ++l) {
+            float* deltas;
+            int n;
+            float cost = run(algos[a], layouts[l], X, y, &deltas, &n);
+            double diff = n == num_vars ? fabs(cost - ref_cost) : INFINITY;
+            for(int i = 0; n == num_vars && i < n; ++i) diff = fmax(diff, fabs(deltas[i] - ref_deltas[i]));
+            int failed = !(diff <= TOLERANCE);
+            printf("%-14s %-8s cost %f, max difference %g%s\n", scyte_conv_algo_string(algos[a]),
+                    scyte_layout_string(layouts[l]), cost, diff, failed ? " FAILED" : "");
+            failures += failed;
+            free(deltas);
+        }
+    }
+    free(ref_deltas); free(X); free(y);
+    return failures != 0;
+}
@@ -0,0 +1,44 @@
+// A network with dropout is built, frozen, trained on replicas and freed. Whether its selects are
+// views depends on their children, which every free loop frees first, so this is meant to be run
+// under a memory checker too, e.g. built with -fsanitize=address
+#include "network.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ROWS 32
+
+static scyte_network* make_net()
+{
+    scyte_node* in = scyte_layer_input(4);
+    scyte_node* hidden = scyte_layer_dropout(scyte_relu(scyte_layer_connected(in, 8)), 0.5f);
+    return scyte_make_network(scyte_layer_cost(hidden, 1, COST_L2));
+}
+
+int main()
+{
+    srand(1);
+    scyte_network* net = make_net();
+    scyte_free_network(net);
+
+    net = make_net();
+    scyte_network* frozen = scyte_freeze_network(net);
+    if(!frozen) return 1;
+    float x[4] = { 0.1f, 0.2f, 0.3f, 0.4f };
+    float p = *scyte_predict_network(frozen, x), q = *scyte_predict_network(net, x);
+    scyte_free_network(frozen);
+
+    // the replicas are freed at the end of a multi-threaded scyte_train_network
+    scyte_data d = { scyte_make_matrix(ROWS, 4), scyte_make_matrix(ROWS, 1) };
+    for(int i = 0; i < ROWS; ++i) {
+        for(int j = 0; j < 4; ++j) d.X.data[i][j] = (float)rand()/RAND_MAX;
+    }
+    scyte_set_network_threads(net, 2);
+    scyte_train_network(net, scyte_sgd_params(0.01f, 0.f, 0.f), 8, 2, 0.25f, 2, d);
+    scyte_free_matrix(&d.X); scyte_free_matrix(&d.y);
+    scyte_free_network(net);
+
+    // dropout is skipped at inference, so the frozen network predicts what the network does
+    printf("frozen prediction %f, network prediction %f\n", p, q);
+    return p - q > 1e-5f || q - p > 1e-5f;
+}
@@ -0,0 +1,37 @@
+// scyte_train_network applies the network's augmentation to the training batches: the data's
+// targets are all 0 and the augmentation sets them to 1, so only a network trained on the
+// augmented batches predicts 1
+#include "network.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ROWS 64
+#define EPOCHS 50
+
+static int num_augmented = 0;
+
+static void set_targets(int batch_size, float* X, float* y, int x_cols, int y_cols)
+{
+    for(int i = 0; i < batch_size*y_cols; ++i) y[i] = 1.f;
+    __atomic_add_fetch(&num_augmented, batch_size, __ATOMIC_RELAXED); // runs on the loader's thread
+}
+
+int main()
+{
+    srand(1);
+    scyte_node* in = scyte_layer_input(2);
+    scyte_network* net = scyte_make_network(scyte_layer_cost(scyte_layer_connected(in, 4), 1, COST_L2));
+    scyte_data d = { scyte_make_matrix(ROWS, 2), scyte_make_matrix(ROWS, 1) };
+    for(int i = 0; i < ROWS; ++i) d.X.data[i][0] = (float)rand()/RAND_MAX, d.X.data[i][1] = (float)rand()/RAND_MAX;
+
+    scyte_set_network_augment(net, set_targets);
+    scyte_train_network(net, scyte_sgd_params(0.05f, 0.f, 0.f), 8, EPOCHS, 0.f, EPOCHS, d);
+    float p = *scyte_predict_network(net, d.X.data[0]);
+    int failed = __atomic_load_n(&num_augmented, __ATOMIC_RELAXED) < EPOCHS*ROWS || p < 0.9f || p > 1.1f;
+    printf("%d samples augmented, prediction %f\n", num_augmented, p);
+
+    scyte_free_matrix(&d.X); scyte_free_matrix(&d.y);
+    scyte_free_network(net);
+    return failed;
+}
@@ -0,0 +1,40 @@
+// scyte_train_network draws the data split, the batch order and the dropout masks from the
+// network's seed: two identical networks trained on replicas with the same seed end up with the
+// same predictions, and one trained with another seed doesn't
+#include "network.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ROWS 64
+#define EPOCHS 5
+
+static float train(scyte_data d, uint64_t seed)
+{
+    srand(1); // the weights are initialized from rand()
+    scyte_node* in = scyte_layer_input(4);
+    scyte_node* hidden = scyte_layer_dropout(scyte_relu(scyte_layer_connected(in, 16)), 0.5f);
+    scyte_network* net = scyte_make_network(scyte_layer_cost(hidden, 1, COST_L2));
+    scyte_set_network_threads(net, 2);
+    scyte_set_network_seed(net, seed);
+    scyte_train_network(net, scyte_sgd_params(0.05f, 0.f, 0.f), 8, EPOCHS, 0.25f, EPOCHS, d);
+    float p = *scyte_predict_network(net, d.X.data[0]);
+    scyte_free_network(net);
+    return p;
+}
+
+int main()
+{
+    srand(2);
+    scyte_data d = { scyte_make_matrix(ROWS, 4), scyte_make_matrix(ROWS, 1) };
+    for(int i = 0; i < ROWS; ++i) {
+        for(int j = 0; j < 4; ++j) d.X.data[i][j] = (float)rand()/RAND_MAX;
+        d.y.data[i][0] = d.X.data[i][0] + d.X.data[i][1];
+    }
+
+    float p = train(d, 7), q = train(d, 7), r = train(d, 8);
+    printf("seed 7: %f and %f, seed 8: %f\n", p, q, r);
+
+    scyte_free_matrix(&d.X); scyte_free_matrix(&d.y);
+    return p != q || p == r;
+}